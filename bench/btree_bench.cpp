@@ -0,0 +1,122 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "splay_tree.hpp"
+#include "btree_map.hpp"
+using namespace cs251;
+
+/*
+* btree_map against splay_tree, side by side on three traces:
+*   uniform  keys inserted in random order, looked up uniformly at random
+*   sorted   keys inserted in ascending order, looked up in ascending sweeps
+*   zipf     keys inserted in random order, looked up with Zipfian skew (exponent 0.99, hot keys
+*            scattered over the key space)
+* and every key extracted again in insertion order.
+*
+* Usage: btree_bench [elements] [lookups]
+*/
+struct trace {
+	std::string m_name;
+	std::vector<int> m_inserts;
+	std::vector<int> m_lookups;
+};
+
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn);
+template <typename Map> void run(const std::string& structure, const trace& t, size_t& sink);
+std::vector<int> zipf_stream(size_t elements, size_t lookups, double exponent, std::mt19937& rng);
+
+int main(int argc, char** argv) {
+	size_t elements = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	size_t lookups = argc > 2 ? std::stoul(argv[2]) : 4000000;
+
+	std::mt19937 rng(251);
+	std::vector<int> sorted(elements);
+	for (size_t i = 0; i < elements; i++)
+		sorted[i] = static_cast<int>(i);
+	std::vector<int> shuffled = sorted;
+	std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+	std::uniform_int_distribution<int> pick(0, static_cast<int>(elements) - 1);
+	std::vector<int> uniform(lookups);
+	for (auto& key : uniform)
+		key = pick(rng);
+	std::vector<int> sweeps(lookups);
+	for (size_t i = 0; i < lookups; i++)
+		sweeps[i] = static_cast<int>(i % elements);
+
+	std::vector<trace> traces = {
+		{"uniform", shuffled, uniform},
+		{"sorted", sorted, sweeps},
+		{"zipf 0.99", shuffled, zipf_stream(elements, lookups, 0.99, rng)},
+	};
+
+	std::cout << "elements " << elements << ", lookups " << lookups << " (ns/op)" << std::endl;
+	std::cout << "btree_map<int,int>: " << btree_map<int,int>::node_capacity << " keys per node, SIMD search "
+		<< (btree_simd_enabled ? "on" : "off") << std::endl;
+	std::cout << std::left << std::setw(12) << "trace" << std::setw(12) << "structure" << std::right
+		<< std::setw(10) << "insert" << std::setw(10) << "lookup" << std::setw(10) << "extract" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+
+	size_t sink = 0;
+	for (const auto& t : traces) {
+		run<splay_tree<int,int>>("splay_tree", t, sink);
+		run<btree_map<int,int>>("btree_map", t, sink);
+	}
+	std::cout << "(" << sink % 10 << ")" << std::endl;
+	return 0;
+}
+
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn) {
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+template <typename Map> void run(const std::string& structure, const trace& t, size_t& sink) {
+	Map map;
+	double insert = time_ns_per_op(t.m_inserts.size(), [&]() {
+		for (int key : t.m_inserts)
+			map.insert(key, std::make_unique<int>(key));
+	});
+	double lookup = time_ns_per_op(t.m_lookups.size(), [&]() {
+		for (int key : t.m_lookups)
+			sink += **map.find(key);
+	});
+	double extract = time_ns_per_op(t.m_inserts.size(), [&]() {
+		for (int key : t.m_inserts)
+			sink += *map.extract(key);
+	});
+	std::cout << std::left << std::setw(12) << t.m_name << std::setw(12) << structure << std::right
+		<< std::setw(10) << insert << std::setw(10) << lookup << std::setw(10) << extract << std::endl;
+}
+
+std::vector<int> zipf_stream(size_t elements, size_t lookups, double exponent, std::mt19937& rng) {
+	//cumulative weights of the ranks, sampled by binary search
+	std::vector<double> cumulative(elements);
+	double total = 0;
+	for (size_t rank = 0; rank < elements; rank++) {
+		total += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+		cumulative[rank] = total;
+	}
+
+	//scatter the ranks over the key space so the hot keys are not neighbours
+	std::vector<int> keyOfRank(elements);
+	for (size_t i = 0; i < elements; i++)
+		keyOfRank[i] = static_cast<int>(i);
+	std::shuffle(keyOfRank.begin(), keyOfRank.end(), rng);
+
+	std::uniform_real_distribution<double> pick(0, total);
+	std::vector<int> stream(lookups);
+	for (auto& key : stream) {
+		size_t rank = std::lower_bound(cumulative.begin(), cumulative.end(), pick(rng)) - cumulative.begin();
+		key = keyOfRank[std::min(rank, elements - 1)];
+	}
+	return stream;
+}
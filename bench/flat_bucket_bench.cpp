@@ -0,0 +1,81 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "adaptive_hash_map.hpp"
+using namespace cs251;
+
+/*
+* adaptive_hash_map with every bucket a splay tree against flat buckets (see set_flat_buckets):
+* random inserts, hits, misses, then extracting every key, at a few load factors. Most buckets
+* hold only a handful of entries, which flat buckets keep in an inline array instead of a tree.
+*
+* Usage: flat_bucket_bench [elements] [lookups]
+*/
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn);
+void run(size_t elements, size_t lookups, double load, bool flat, std::mt19937& rng);
+
+int main(int argc, char** argv) {
+	size_t elements = argc > 1 ? std::stoul(argv[1]) : 500000;
+	size_t lookups = argc > 2 ? std::stoul(argv[2]) : 2000000;
+
+	std::mt19937 rng(251);
+	std::cout << "elements " << elements << ", lookups " << lookups << ", flat_capacity "
+		<< adaptive_hash_map<int,int>::flat_capacity << " (ns/op)" << std::endl;
+	std::cout << std::left << std::setw(8) << "load" << std::setw(8) << "buckets" << std::right
+		<< std::setw(10) << "insert" << std::setw(10) << "hit" << std::setw(10) << "miss"
+		<< std::setw(10) << "extract" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+	for (double load : {0.5, 1.0, 2.0}) {
+		run(elements, lookups, load, false, rng);
+		run(elements, lookups, load, true, rng);
+	}
+	return 0;
+}
+
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn) {
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+void run(size_t elements, size_t lookups, double load, bool flat, std::mt19937& rng) {
+	//even keys are present, odd keys are misses
+	std::vector<int> keys(elements);
+	for (size_t i = 0; i < elements; i++)
+		keys[i] = static_cast<int>(i * 2);
+	std::shuffle(keys.begin(), keys.end(), rng);
+	std::vector<int> queries(lookups);
+	std::uniform_int_distribution<size_t> pick(0, elements - 1);
+	for (auto& query : queries)
+		query = keys[pick(rng)];
+
+	size_t sink = 0;
+	adaptive_hash_map<int,int> map(std::max<size_t>(1, static_cast<size_t>(elements / load)));
+	map.set_flat_buckets(flat);
+	double insert = time_ns_per_op(keys.size(), [&]() {
+		for (int key : keys)
+			map.insert(key, std::make_unique<int>(key));
+	});
+	double hit = time_ns_per_op(queries.size(), [&]() {
+		for (int key : queries)
+			sink += **map.find(key);
+	});
+	double miss = time_ns_per_op(queries.size(), [&]() {
+		for (int key : queries)
+			sink += map.find(key + 1) == nullptr;
+	});
+	std::shuffle(keys.begin(), keys.end(), rng);
+	double extract = time_ns_per_op(keys.size(), [&]() {
+		for (int key : keys)
+			sink += *map.extract(key);
+	});
+	std::cout << std::left << std::setw(8) << load << std::setw(8) << (flat ? "flat" : "trees") << std::right
+		<< std::setw(10) << insert << std::setw(10) << hit << std::setw(10) << miss
+		<< std::setw(10) << extract << "  (" << sink % 10 << ")" << std::endl;
+}
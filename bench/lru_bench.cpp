@@ -0,0 +1,75 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "lru_cache.hpp"
+using namespace cs251;
+
+/*
+* lru_cache throughput: filling the cache, inserts that each evict the coldest entry, and
+* lookups over keys drawn from a skewed distribution, so the hot keys stay cached and the
+* hit rate depends on the cache size. Also reports the hit rate and eviction count.
+*
+* Usage: lru_bench [capacity] [keys] [lookups]
+*/
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn);
+void run(size_t capacity, size_t keys, size_t lookups, std::mt19937& rng);
+
+int main(int argc, char** argv) {
+	size_t capacity = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	size_t keys = argc > 2 ? std::stoul(argv[2]) : 4000000;
+	size_t lookups = argc > 3 ? std::stoul(argv[3]) : 4000000;
+
+	std::mt19937 rng(251);
+	std::cout << "keys " << keys << ", lookups " << lookups << " (ns/op)" << std::endl;
+	std::cout << std::left << std::setw(10) << "capacity" << std::right << std::setw(10) << "fill"
+		<< std::setw(10) << "evict" << std::setw(10) << "lookup" << std::setw(10) << "hit %"
+		<< std::setw(12) << "evictions" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+	for (size_t size : {capacity / 16, capacity / 4, capacity})
+		run(std::max<size_t>(1, size), keys, lookups, rng);
+	return 0;
+}
+
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn) {
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+void run(size_t capacity, size_t keys, size_t lookups, std::mt19937& rng) {
+	//a few keys take most of the lookups; a miss inserts the key, evicting the coldest entry
+	std::vector<int> queries(lookups);
+	std::exponential_distribution<double> skew(8.0 / static_cast<double>(keys));
+	for (auto& query : queries)
+		query = static_cast<int>(std::min(skew(rng), static_cast<double>(keys - 1)));
+
+	size_t sink = 0;
+	lru_cache<int,int> cache(capacity);
+	double fill = time_ns_per_op(capacity, [&]() {
+		for (size_t i = 0; i < capacity; i++)
+			cache.insert(static_cast<int>(keys + i), std::make_unique<int>(static_cast<int>(i)));
+	});
+	double evict = time_ns_per_op(capacity, [&]() {
+		for (size_t i = 0; i < capacity; i++)
+			cache.insert(static_cast<int>(keys + capacity + i), std::make_unique<int>(static_cast<int>(i)));
+	});
+	size_t hits = cache.hits();
+	double lookup = time_ns_per_op(queries.size(), [&]() {
+		for (int key : queries) {
+			const std::unique_ptr<int>* value = cache.find(key);
+			if (value)
+				sink += **value;
+			else
+				cache.insert(key, std::make_unique<int>(key));
+		}
+	});
+	double hitRate = 100.0 * static_cast<double>(cache.hits() - hits) / static_cast<double>(queries.size());
+	std::cout << std::left << std::setw(10) << capacity << std::right << std::setw(10) << fill
+		<< std::setw(10) << evict << std::setw(10) << lookup << std::setw(10) << hitRate
+		<< std::setw(12) << cache.evictions() << "  (" << sink % 10 << ")" << std::endl;
+}
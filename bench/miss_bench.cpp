@@ -0,0 +1,117 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+#include <string>
+#include "hash_map.hpp"
+#include "adaptive_hash_map.hpp"
+#include "splay_tree.hpp"
+using namespace cs251;
+
+/*
+* Miss throughput benchmark: compares the exception-based peek/extract/insert
+* paths against find/try_extract/try_insert on lookups that are expected to fail,
+* then times find again after misses cycles of inserting and extracting fresh keys.
+*
+* Usage: miss_bench [elements] [misses]
+*/
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn);
+template <typename Map> void run_bench(const std::string& label, size_t elements, size_t misses);
+
+int main(int argc, char** argv) {
+	size_t elements = argc > 1 ? std::stoul(argv[1]) : 1000;
+	size_t misses = argc > 2 ? std::stoul(argv[2]) : 200000;
+
+	std::cout << "elements " << elements << ", misses " << misses << std::endl;
+	run_bench<hash_map<int,int>>("hash_map", elements, misses);
+	run_bench<adaptive_hash_map<int,int>>("adaptive_hash_map", elements, misses);
+	run_bench<splay_tree<int,int>>("splay_tree", elements, misses);
+	return 0;
+}
+
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn) {
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+template <typename Map> Map make_map(size_t elements) {
+	if constexpr (std::is_same_v<Map, splay_tree<int,int>>)
+		return Map();
+	else
+		return Map(elements * 2);
+}
+
+template <typename Map> void run_bench(const std::string& label, size_t elements, size_t misses) {
+	Map map = make_map<Map>(elements);
+	// Even keys are present, odd keys are misses
+	for (size_t i = 0; i < elements; i++)
+		map.insert(static_cast<int>(i * 2), std::make_unique<int>(static_cast<int>(i)));
+
+	size_t sink = 0;
+	double peek_throw = time_ns_per_op(misses, [&]() {
+		for (size_t i = 0; i < misses; i++) {
+			try {
+				sink += *map.peek(static_cast<int>((i % elements) * 2 + 1));
+			} catch (const nonexistent_key&) {
+				sink++;
+			}
+		}
+	});
+	double peek_find = time_ns_per_op(misses, [&]() {
+		for (size_t i = 0; i < misses; i++) {
+			const auto* value = map.find(static_cast<int>((i % elements) * 2 + 1));
+			sink += value ? **value : 1;
+		}
+	});
+	double extract_throw = time_ns_per_op(misses, [&]() {
+		for (size_t i = 0; i < misses; i++) {
+			try {
+				sink += *map.extract(static_cast<int>((i % elements) * 2 + 1));
+			} catch (const nonexistent_key&) {
+				sink++;
+			}
+		}
+	});
+	double extract_try = time_ns_per_op(misses, [&]() {
+		for (size_t i = 0; i < misses; i++) {
+			auto value = map.try_extract(static_cast<int>((i % elements) * 2 + 1));
+			sink += value ? **value : 1;
+		}
+	});
+	double insert_throw = time_ns_per_op(misses, [&]() {
+		for (size_t i = 0; i < misses; i++) {
+			try {
+				map.insert(static_cast<int>((i % elements) * 2), std::make_unique<int>(0));
+			} catch (const duplicate_key&) {
+				sink++;
+			}
+		}
+	});
+	double insert_try = time_ns_per_op(misses, [&]() {
+		for (size_t i = 0; i < misses; i++)
+			sink += map.try_insert(static_cast<int>((i % elements) * 2), std::make_unique<int>(0)) ? 0 : 1;
+	});
+
+	// Churn through keys above every present one, leaving the same elements behind
+	for (size_t i = 0; i < misses; i++) {
+		int key = static_cast<int>(elements * 2 + i);
+		map.try_insert(key, std::make_unique<int>(0));
+		map.try_extract(key);
+	}
+	double churn_find = time_ns_per_op(misses, [&]() {
+		for (size_t i = 0; i < misses; i++) {
+			const auto* value = map.find(static_cast<int>((i % elements) * 2 + 1));
+			sink += value ? **value : 1;
+		}
+	});
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << std::setw(18) << label
+		<< "  peek/find " << std::setw(8) << peek_throw << " -> " << std::setw(8) << peek_find << " ns"
+		<< "  extract/try_extract " << std::setw(8) << extract_throw << " -> " << std::setw(8) << extract_try << " ns"
+		<< "  insert/try_insert " << std::setw(8) << insert_throw << " -> " << std::setw(8) << insert_try << " ns"
+		<< "  find after churn " << std::setw(8) << churn_find << " ns"
+		<< "  (" << sink % 10 << ")" << std::endl;
+}
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "app.hpp"
+#include "splay_tree.hpp"
+using namespace cs251;
+
+/*
+* splay_tree throughput with string and name keys, where each comparison scans characters:
+* random inserts, random hits and extracting every key. Keys share long common prefixes, as
+* identifiers and surnames do, so comparisons cannot stop at the first byte.
+*
+* Usage: splay_key_bench [elements] [lookups]
+*/
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn);
+template <typename K> void run(const std::string& label, const std::vector<K>& keys, size_t lookups, std::mt19937& rng);
+std::string make_text(size_t i);
+
+int main(int argc, char** argv) {
+	size_t elements = argc > 1 ? std::stoul(argv[1]) : 300000;
+	size_t lookups = argc > 2 ? std::stoul(argv[2]) : 1000000;
+
+	std::mt19937 rng(251);
+	std::vector<std::string> strings(elements);
+	std::vector<name> names(elements);
+	for (size_t i = 0; i < elements; i++) {
+		strings[i] = "customer/" + make_text(i);
+		//few distinct surnames, so most comparisons also reach the first name
+		names[i] = name(make_text(i), "Surname" + std::to_string(i % 64));
+	}
+
+	std::cout << "elements " << elements << ", lookups " << lookups << " (ns/op)" << std::endl;
+	std::cout << std::left << std::setw(10) << "keys" << std::right << std::setw(10) << "insert"
+		<< std::setw(10) << "find" << std::setw(10) << "extract" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+	run("string", strings, lookups, rng);
+	run("name", names, lookups, rng);
+	return 0;
+}
+
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn) {
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+template <typename K> void run(const std::string& label, const std::vector<K>& keys, size_t lookups, std::mt19937& rng) {
+	std::vector<K> order = keys;
+	std::shuffle(order.begin(), order.end(), rng);
+	std::vector<K> queries(lookups);
+	std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+	for (auto& query : queries)
+		query = keys[pick(rng)];
+
+	size_t sink = 0;
+	splay_tree<K,int> tree;
+	double insert = time_ns_per_op(order.size(), [&]() {
+		for (const K& key : order)
+			tree.insert(key, std::make_unique<int>(1));
+	});
+	double find = time_ns_per_op(queries.size(), [&]() {
+		for (const K& key : queries)
+			sink += **tree.find(key);
+	});
+	std::shuffle(order.begin(), order.end(), rng);
+	double extract = time_ns_per_op(order.size(), [&]() {
+		for (const K& key : order)
+			sink += *tree.extract(key);
+	});
+	std::cout << std::left << std::setw(10) << label << std::right << std::setw(10) << insert
+		<< std::setw(10) << find << std::setw(10) << extract << "  (" << sink % 10 << ")" << std::endl;
+}
+
+//a zero-padded decimal, so neighbouring keys share all but their last few characters
+std::string make_text(size_t i) {
+	std::string digits = std::to_string(i);
+	return std::string(12 - std::min<size_t>(digits.size(), 12), '0') + digits;
+}
@@ -0,0 +1,117 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "splay_tree.hpp"
+using namespace cs251;
+
+/*
+* Splay policy benchmark: lookup throughput of each splay_policy on a uniform access
+* stream and on a Zipfian one (exponent 0.99, hot keys scattered over the key space), and of
+* frequency-driven weighted rebuilds paired with a policy that rarely splays.
+*
+* Usage: splay_policy_bench [elements] [lookups]
+*/
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn);
+std::vector<int> uniform_stream(size_t elements, size_t lookups, std::mt19937& rng);
+std::vector<int> zipf_stream(size_t elements, size_t lookups, double exponent, std::mt19937& rng);
+
+int main(int argc, char** argv) {
+	size_t elements = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	size_t lookups = argc > 2 ? std::stoul(argv[2]) : 4000000;
+
+	std::mt19937 rng(251);
+	std::vector<int> keys(elements);
+	for (size_t i = 0; i < elements; i++)
+		keys[i] = static_cast<int>(i);
+	std::shuffle(keys.begin(), keys.end(), rng);
+
+	struct configuration {
+		std::string m_name;
+		splay_policy m_policy;
+		bool m_autoRebuild;
+	};
+	std::vector<configuration> configurations = {
+		{"full", splay_policy::full(), false},
+		{"semi", splay_policy::semi(), false},
+		{"every 8th", splay_policy::every_kth(8), false},
+		{"p = 0.1", splay_policy::with_probability(0.1f), false},
+		{"depth > 2 log n", splay_policy::depth_threshold(2.0f), false},
+		{"weighted rebuild", splay_policy::depth_threshold(4.0f), true},
+	};
+	std::vector<std::pair<std::string, std::vector<int>>> streams = {
+		{"uniform", uniform_stream(elements, lookups, rng)},
+		{"zipf 0.99", zipf_stream(elements, lookups, 0.99, rng)},
+	};
+
+	std::cout << "elements " << elements << ", lookups " << lookups << " (ns/lookup)" << std::endl;
+	std::cout << std::left << std::setw(18) << "policy";
+	for (const auto& stream : streams)
+		std::cout << std::right << std::setw(12) << stream.first;
+	std::cout << std::endl << std::fixed << std::setprecision(1);
+
+	size_t sink = 0;
+	for (const auto& config : configurations) {
+		std::cout << std::left << std::setw(18) << config.m_name;
+		for (const auto& stream : streams) {
+			splay_tree<int,int> tree;
+			for (int key : keys)
+				tree.insert(key, std::make_unique<int>(key));
+			tree.set_splay_policy(config.m_policy);
+			if (config.m_autoRebuild)
+				tree.set_auto_rebuild(elements);
+			double ns = time_ns_per_op(stream.second.size(), [&]() {
+				for (int key : stream.second)
+					sink += **tree.find(key);
+			});
+			std::cout << std::right << std::setw(12) << ns;
+		}
+		std::cout << std::endl;
+	}
+	std::cout << "(" << sink % 10 << ")" << std::endl;
+	return 0;
+}
+
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn) {
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+std::vector<int> uniform_stream(size_t elements, size_t lookups, std::mt19937& rng) {
+	std::uniform_int_distribution<int> pick(0, static_cast<int>(elements) - 1);
+	std::vector<int> stream(lookups);
+	for (auto& key : stream)
+		key = pick(rng);
+	return stream;
+}
+
+std::vector<int> zipf_stream(size_t elements, size_t lookups, double exponent, std::mt19937& rng) {
+	//cumulative weights of the ranks, sampled by binary search
+	std::vector<double> cumulative(elements);
+	double total = 0;
+	for (size_t rank = 0; rank < elements; rank++) {
+		total += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+		cumulative[rank] = total;
+	}
+
+	//scatter the ranks over the key space so the hot keys are not neighbours
+	std::vector<int> keyOfRank(elements);
+	for (size_t i = 0; i < elements; i++)
+		keyOfRank[i] = static_cast<int>(i);
+	std::shuffle(keyOfRank.begin(), keyOfRank.end(), rng);
+
+	std::uniform_real_distribution<double> pick(0, total);
+	std::vector<int> stream(lookups);
+	for (auto& key : stream) {
+		size_t rank = std::lower_bound(cumulative.begin(), cumulative.end(), pick(rng)) - cumulative.begin();
+		key = keyOfRank[std::min(rank, elements - 1)];
+	}
+	return stream;
+}
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <utility>
+#include <span>
+#include <algorithm>
+#include "splay_tree.hpp"
+using namespace cs251;
+
+/*
+* splay_tree throughput benchmark: random inserts, random hits (one at a time and in batches),
+* then extracting every key.
+*
+* Usage: splay_tree_bench [elements] [lookups]
+*/
+template <typename Fn> double time_ns_per_op(size_t ops, Fn fn) {
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+int main(int argc, char** argv) {
+	size_t elements = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	size_t lookups = argc > 2 ? std::stoul(argv[2]) : 2000000;
+
+	std::mt19937 rng(251);
+	std::vector<int> keys(elements);
+	for (size_t i = 0; i < elements; i++)
+		keys[i] = static_cast<int>(i);
+	std::shuffle(keys.begin(), keys.end(), rng);
+
+	std::vector<int> queries(lookups);
+	std::uniform_int_distribution<size_t> pick(0, elements - 1);
+	for (auto& query : queries)
+		query = keys[pick(rng)];
+
+	size_t sink = 0;
+	auto tree = std::make_unique<splay_tree<int,int>>();
+	double insert = time_ns_per_op(elements, [&]() {
+		for (int key : keys)
+			tree->insert(key, std::make_unique<int>(key));
+	});
+	double peek = time_ns_per_op(lookups, [&]() {
+		for (int key : queries)
+			sink += *tree->peek(key);
+	});
+	//the same lookups resolved a batch at a time
+	const size_t batch = 4096;
+	double peekMany = time_ns_per_op(lookups, [&]() {
+		for (size_t i = 0; i < lookups; i += batch) {
+			std::span<const int> part(queries.data() + i, std::min(batch, lookups - i));
+			for (const auto* value : tree->peek_many(part))
+				sink += **value;
+		}
+	});
+	std::shuffle(keys.begin(), keys.end(), rng);
+	double extract = time_ns_per_op(elements, [&]() {
+		for (int key : keys)
+			sink += *tree->extract(key);
+	});
+	double teardown = time_ns_per_op(1, [&]() {
+		for (size_t i = 0; i < elements; i++)
+			tree->insert(keys[i], std::make_unique<int>(0));
+		tree.reset();
+	});
+	//ascending inserts leave a single chain as deep as the tree is large
+	double chain = time_ns_per_op(1, [&]() {
+		tree = std::make_unique<splay_tree<int,int>>();
+		for (size_t i = 0; i < elements; i++)
+			tree->insert(static_cast<int>(i), std::make_unique<int>(0));
+		tree.reset();
+	});
+
+	//bulk loading the same sorted keys
+	auto make_entries = [&](bool shuffled) {
+		std::vector<std::pair<int, std::unique_ptr<int>>> entries(elements);
+		for (size_t i = 0; i < elements; i++)
+			entries[i] = {static_cast<int>(i), std::make_unique<int>(0)};
+		if (shuffled)
+			std::shuffle(entries.begin(), entries.end(), rng);
+		return entries;
+	};
+	auto sorted = make_entries(false);
+	double loadSorted = time_ns_per_op(1, [&]() {
+		sink += splay_tree<int,int>::build_sorted(sorted).size();
+	});
+	auto unsorted = make_entries(true);
+	double load = time_ns_per_op(1, [&]() {
+		sink += splay_tree<int,int>::build(unsorted).size();
+	});
+	unsorted = make_entries(true);
+	double loadParallel = time_ns_per_op(1, [&]() {
+		sink += splay_tree<int,int>::build(unsorted, true).size();
+	});
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "elements " << elements << ", lookups " << lookups
+		<< ", node size " << sizeof(splay_tree<int,int>::tree_node) << " bytes" << std::endl;
+	std::cout << "insert  " << std::setw(8) << insert << " ns/op" << std::endl;
+	std::cout << "peek    " << std::setw(8) << peek << " ns/op" << std::endl;
+	std::cout << "peek_many (batches of " << batch << ") " << std::setw(8) << peekMany << " ns/op" << std::endl;
+	std::cout << "extract " << std::setw(8) << extract << " ns/op" << std::endl;
+	std::cout << "refill + teardown " << std::setw(8) << teardown / 1e6 << " ms" << std::endl;
+	std::cout << "sorted chain refill + teardown " << std::setw(8) << chain / 1e6 << " ms" << std::endl;
+	std::cout << "build_sorted " << std::setw(8) << loadSorted / 1e6 << " ms" << std::endl;
+	std::cout << "build        " << std::setw(8) << load / 1e6 << " ms" << std::endl;
+	std::cout << "build (parallel) " << std::setw(8) << loadParallel / 1e6 << " ms" << std::endl;
+	std::cout << "(" << sink % 10 << ")" << std::endl;
+	return 0;
+}
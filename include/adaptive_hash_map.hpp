@@ -1,23 +1,92 @@
 #pragma once
 #include <vector>
+#include <variant>
+#include <algorithm>
+#include <array>
 #include <memory>
+#include <optional>
+#include <chrono>
+#include <tuple>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
 #include "splay_tree.hpp"
+#include "expiry_index.hpp"
 namespace cs251 {
 
 template <typename K, typename V>
 class adaptive_hash_map {
 public:
-	// Return a constant reference to the hash table vector
-	const std::vector<splay_tree<K,V>>& get_data() const;
+	// Read-only access to the buckets, indexed like the table
+	// Every bucket reads as a splay tree; a flat bucket reads as an empty one, and its entries
+	// are visited with for_each_flat
+	class bucket_view {
+	public:
+		// Return the number of buckets
+		size_t size() const;
+		// Return the tree of bucket i, or an empty tree if bucket i is flat
+		const splay_tree<K,V>& operator[](size_t i) const;
+		// Return whether bucket i is flat
+		bool is_flat(size_t i) const;
+		// Call fn(key, value) for every entry of bucket i if it is flat, in no particular order
+		template <typename Fn> void for_each_flat(size_t i, Fn fn) const;
+
+	private:
+		friend class adaptive_hash_map;
+		explicit bucket_view(const adaptive_hash_map& map);
+
+		const adaptive_hash_map* m_map;
+	};
+
+	// Return a view of the hash table buckets
+	bucket_view get_data() const;
 
 	// Default constructor - construct a hash table with a capacity of 1
 	adaptive_hash_map();
 	// Constructor - create a hash table with a capacity of bucketCount
 	adaptive_hash_map(size_t bucketCount);
+	// Moving leaves other as an empty table of one bucket with its own node pool, which allocates
+	adaptive_hash_map(adaptive_hash_map&& other);
+	adaptive_hash_map& operator=(adaptive_hash_map&& other);
+	// Destructor - the buckets share one node pool, which is freed a slab at a time
+	~adaptive_hash_map();
 
 	// Get the hash code for a given key
 	size_t hash_code(K key) const;
 
+	// Change the number of buckets to bucketCount, moving every node into its new bucket's tree
+	// without reallocating it, and rebuild each new tree balanced
+	// This is O(n) when bucketCount is a multiple of the current count, because each new bucket
+	// then takes the nodes of a single old bucket, already in key order; otherwise the nodes of
+	// each new bucket are sorted, for O(n log b) overall with b entries per new bucket
+	// Throw std::invalid_argument if bucketCount is 0
+	void resize(size_t bucketCount);
+	// Return the average number of elements per bucket
+	float load_factor() const;
+	// Return the load factor above which an insert doubles the bucket count, 0 if it never does
+	float max_load_factor() const;
+	// Set the maximum load factor (0, the default, turns automatic resizing off), and grow the table
+	// at once if it is already above it
+	// Throw std::invalid_argument if maxLoadFactor is negative
+	void set_max_load_factor(float maxLoadFactor);
+
+	// Flat buckets - a bucket of at most flat_capacity entries holds them in a small inline array
+	// searched linearly instead of a splay tree, becomes a tree when it outgrows the array, and
+	// turns back into one once it shrinks to flat_shrink entries; on by default
+	// Tree buckets live out of line, so a bucket takes the space of its array rather than of a tree;
+	// with flat buckets off every bucket is such a tree, one pointer away from the table
+	// The array holds as many entries as fit in a 64-byte cache line, and from 2 to 4
+	static constexpr size_t flat_capacity =
+		std::clamp<size_t>(63 / (sizeof(K) + sizeof(std::unique_ptr<V>)), 2, 4);
+	// The size a tree bucket shrinks to before it turns flat again; the gap to flat_capacity keeps
+	// a bucket at the boundary from converting on every operation
+	static constexpr size_t flat_shrink = std::max<size_t>(flat_capacity / 2, 1);
+	// Turn flat buckets on or off, converting the existing buckets
+	void set_flat_buckets(bool enabled);
+	// Return whether flat buckets are on
+	bool flat_buckets() const;
+
 	// Insert the key/value pair into the table, if the key doesn't already exist
 	// Throw duplicate_key if the key already exists
 	void insert(const K& key, std::unique_ptr<V> value);
@@ -28,63 +97,910 @@ public:
 	// Throw nonexistent_key if the key is not in the hash table
 	std::unique_ptr<V> extract(const K& key);
 
-	// Return the current number of elements in the hash table
+	// Non-throwing counterparts of insert/peek/extract for miss-heavy callers
+	// Insert the key/value pair and return true, or return false if the key already exists
+	bool try_insert(const K& key, std::unique_ptr<V> value);
+	// Return a pointer to the value associated with the given key, or nullptr if it is missing
+	const std::unique_ptr<V>* find(const K& key);
+	// Remove and return the value associated with the given key, or std::nullopt if it is missing
+	std::optional<std::unique_ptr<V>> try_extract(const K& key);
+
+	// Time-to-live support - an entry whose ttl has passed behaves as missing and is reclaimed
+	// either when it is next accessed or by a sweep that every operation advances a few steps
+	// Insert the key/value pair with a time-to-live
+	// Throw duplicate_key if the key already exists
+	void insert(const K& key, std::unique_ptr<V> value, std::chrono::steady_clock::duration ttl);
+	// Insert the key/value pair with a time-to-live and return true, or return false if the key already exists
+	bool try_insert(const K& key, std::unique_ptr<V> value, std::chrono::steady_clock::duration ttl);
+	// Set or refresh the time-to-live of an existing key; return false if the key is missing
+	bool expire_after(const K& key, std::chrono::steady_clock::duration ttl);
+	// Reclaim every expired entry now and return how many were reclaimed
+	size_t purge_expired();
+
+	// Move every entry of other into this table
+	// When nothing but other allocates from its node pool, its slabs become ours and tree nodes are
+	// relinked rather than reallocated; otherwise each moved node is copied into our pool
+	// Buckets are merged tree-to-tree when both tables have the same bucket count, and entries of
+	// flat buckets move one at a time; conflicts are resolved by policy
+	// Moved entries keep their time-to-live, as do entries that overwrite one of ours; one without a
+	// time-to-live clears the deadline of the entry it overwrites
+	// Return the number of entries moved into this table
+	size_t merge(adaptive_hash_map& other, merge_policy policy = merge_policy::keep_existing);
+	size_t merge(adaptive_hash_map&& other, merge_policy policy = merge_policy::keep_existing);
+
+	// Return the current number of elements in the hash table, including expired entries
+	// that have not been reclaimed yet
 	size_t size() const;
 	// Return the capacity of the hash table
 	size_t bucket_count() const;
 	// Return whether the hash table is currently empty
 	bool empty() const;
+	// Remove every element, keeping the bucket count; the buckets share one node pool,
+	// so this frees the nodes a slab at a time
+	void clear();
+
+	// Return the stats of every tree bucket combined (see splay_tree::stats), with the entries of
+	// flat buckets counted apart from the tree nodes
+	splay_stats stats() const;
+	// Zero the splay counters of every bucket
+	void reset_stats();
+
+	// Warm restarts - every tree bucket keeps its exact splayed shape (see splay_tree::save), and
+	// entries with a time-to-live keep the time they had left
+	// Write the table to the file at path; entries that have expired but not been reclaimed are
+	// written too, and are reclaimed when the table is loaded
+	// Throw serialization_error if the file cannot be written
+	void save(const std::string& path) const;
+	void save(std::ostream& out) const;
+	// Replace the contents of the table, including its bucket count, with those saved in the file at path
+	// Throw serialization_error if the file cannot be read or does not hold a saved table, leaving
+	// the table unchanged
+	void load(const std::string& path);
+	void load(std::istream& in);
 
 private:
-	// The hash table array of splay trees
-	std::vector<splay_tree<K,V>> m_data {};
+	// A bucket of at most flat_capacity entries, in no particular order
+	struct flat_bucket {
+		std::array<K, flat_capacity> m_keys {};
+		std::array<std::unique_ptr<V>, flat_capacity> m_values {};
+		uint8_t m_count = 0;
+	};
+	// Every bucket is a splay tree unless flat buckets are on and it is small enough to be flat
+	using tree_bucket = std::unique_ptr<splay_tree<K,V>>;
+	using bucket = std::variant<tree_bucket, flat_bucket>;
+
+	// The hash table array of buckets
+	std::vector<bucket> m_data {};
 
 	// TODO: Add any additional methods or variables here
     size_t m_bucketCount;
     size_t m_numElements;
+    float m_maxLoadFactor = 0.0f;
+    bool m_flatBuckets = true;
+    // The node pool every tree bucket allocates from
+    using node_pool_type = node_pool<typename splay_tree<K,V>::tree_node>;
+    std::shared_ptr<node_pool_type> m_pool;
+    // Splay counters of the tree buckets that have since become flat, so the totals keep them
+    splay_counters m_flatCounters {};
+    // Deadlines of the entries inserted with a time-to-live
+    expiry_index<K> m_expiry;
+
+    using node_list = typename splay_tree<K,V>::node_list;
+    using entry_list = std::vector<std::pair<K, std::unique_ptr<V>>>;
+    static tree_bucket make_tree(const std::shared_ptr<node_pool_type>& pool);
+    static std::vector<bucket> make_buckets(size_t bucketCount, const std::shared_ptr<node_pool_type>& pool, bool flat);
+    void reset_empty();
+    void grow_to_fit();
+    void carry_counters(const std::vector<bucket>& from, std::vector<bucket>& to);
+    void forget_buckets();
+    bool owns_pool() const;
+    typename splay_tree<K,V>::tree_node* make_node(K key, std::unique_ptr<V> value);
+    static bool key_less(const K& a, const K& b);
+    static splay_tree<K,V>* tree_of(bucket& entry);
+    static const splay_tree<K,V>* tree_of(const bucket& entry);
+    bool is_flat(size_t bucket) const;
+    size_t bucket_size(size_t bucket) const;
+    static size_t flat_find(const flat_bucket& flat, const K& key);
+    static void flat_append(flat_bucket& flat, K key, std::unique_ptr<V> value);
+    bool bucket_insert(size_t bucket, const K& key, std::unique_ptr<V> value);
+    const std::unique_ptr<V>* bucket_find(size_t bucket, const K& key);
+    std::unique_ptr<V>* bucket_slot(size_t bucket, const K& key);
+    std::optional<std::unique_ptr<V>> bucket_extract(size_t bucket, const K& key);
+    void treeify(size_t bucket);
+    void flatten(size_t bucket);
+    void flatten_all();
+    void unflatten_all();
+    enum class merge_result { moved, resolved, collected };
+    merge_result merge_entry(const K& key, std::unique_ptr<V>& value, merge_policy policy);
+    static void write_flat(std::ostream& out, const flat_bucket& flat);
+    static constexpr char file_magic[8] = {'C', 'S', '2', '5', '1', 'A', 'H', 'M'};
+    static constexpr uint32_t file_version = 1;
+    void remove(const K& key);
+    void expire_some();
+    bool expire_if_due(const K& key);
 };
 
 template <typename K, typename V>
-const std::vector<splay_tree<K,V>>& adaptive_hash_map<K,V>::get_data() const {
-	return m_data;
+adaptive_hash_map<K,V>::bucket_view::bucket_view(const adaptive_hash_map& map) : m_map(&map) {}
+
+template <typename K, typename V>
+size_t adaptive_hash_map<K,V>::bucket_view::size() const {
+    return m_map->m_data.size();
+}
+
+template <typename K, typename V>
+const splay_tree<K,V>& adaptive_hash_map<K,V>::bucket_view::operator[](const size_t i) const {
+    static const splay_tree<K,V> none;
+    const splay_tree<K,V>* tree = tree_of(m_map->m_data[i]);
+    return tree != nullptr ? *tree : none;
+}
+
+template <typename K, typename V>
+bool adaptive_hash_map<K,V>::bucket_view::is_flat(const size_t i) const {
+    return m_map->is_flat(i);
+}
+
+template <typename K, typename V>
+template <typename Fn>
+void adaptive_hash_map<K,V>::bucket_view::for_each_flat(const size_t i, Fn fn) const {
+    if (const flat_bucket* flat = std::get_if<flat_bucket>(&m_map->m_data[i])) {
+        for (size_t j = 0; j < flat->m_count; j++) {
+            fn(flat->m_keys[j], flat->m_values[j]);
+        }
+    }
+}
+
+template <typename K, typename V>
+typename adaptive_hash_map<K,V>::bucket_view adaptive_hash_map<K,V>::get_data() const {
+	return bucket_view(*this);
 }
 
 template <typename K, typename V>
 adaptive_hash_map<K,V>::adaptive_hash_map() {
-    m_data = std::vector<splay_tree<K,V>>(1);
+    m_pool = std::make_shared<node_pool_type>();
+    m_data = make_buckets(1, m_pool, m_flatBuckets);
     m_bucketCount = 1;
     m_numElements = 0;
 }
 
 template <typename K, typename V>
 adaptive_hash_map<K,V>::adaptive_hash_map(const size_t bucketCount) {
-    m_data = std::vector<splay_tree<K,V>>(bucketCount);
+    m_pool = std::make_shared<node_pool_type>();
+    m_data = make_buckets(bucketCount, m_pool, m_flatBuckets);
     m_bucketCount = bucketCount;
     m_numElements = 0;
 }
 
+template <typename K, typename V>
+adaptive_hash_map<K,V>::adaptive_hash_map(adaptive_hash_map&& other)
+    : m_data(std::move(other.m_data)), m_bucketCount(other.m_bucketCount), m_numElements(other.m_numElements),
+      m_maxLoadFactor(other.m_maxLoadFactor), m_flatBuckets(other.m_flatBuckets), m_pool(std::move(other.m_pool)),
+      m_flatCounters(other.m_flatCounters), m_expiry(std::move(other.m_expiry)) {
+    other.reset_empty();
+}
+
+template <typename K, typename V>
+adaptive_hash_map<K,V>& adaptive_hash_map<K,V>::operator=(adaptive_hash_map&& other) {
+    if (this != &other) {
+        forget_buckets();
+        m_data = std::move(other.m_data);
+        m_bucketCount = other.m_bucketCount;
+        m_numElements = other.m_numElements;
+        m_maxLoadFactor = other.m_maxLoadFactor;
+        m_flatBuckets = other.m_flatBuckets;
+        m_pool = std::move(other.m_pool);
+        m_flatCounters = other.m_flatCounters;
+        m_expiry = std::move(other.m_expiry);
+        other.reset_empty();
+    }
+    return *this;
+}
+
+//leave a table whose contents were moved away as one empty bucket with a pool of its own,
+//keeping its load factor and flat bucket settings
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::reset_empty() {
+    m_pool = std::make_shared<node_pool_type>();
+    m_data = make_buckets(1, m_pool, m_flatBuckets);
+    m_bucketCount = 1;
+    m_numElements = 0;
+    m_flatCounters = splay_counters();
+    m_expiry = expiry_index<K>();
+}
+
+template <typename K, typename V>
+adaptive_hash_map<K,V>::~adaptive_hash_map() {
+    forget_buckets();
+}
+
+//whether nothing but the table and its tree buckets holds the pool
+template <typename K, typename V>
+bool adaptive_hash_map<K,V>::owns_pool() const {
+    if (m_pool == nullptr) {
+        return false;
+    }
+    long trees = 0;
+    for (const auto& entry : m_data) {
+        if (const auto* tree = tree_of(entry)) {
+            if (tree->m_pool != m_pool) {
+                return false;
+            }
+            trees++;
+        }
+    }
+    return m_pool.use_count() == trees + 1;
+}
+
+//let the tree buckets drop their nodes unreleased when the table owns the pool, so destroying them
+//frees it a slab at a time rather than node by node
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::forget_buckets() {
+    if (!owns_pool()) {
+        return;
+    }
+    for (auto& entry : m_data) {
+        if (auto* tree = tree_of(entry)) {
+            tree->forget_nodes();
+        }
+    }
+}
+
+//create an empty tree bucket that allocates its nodes from pool
+template <typename K, typename V>
+typename adaptive_hash_map<K,V>::tree_bucket adaptive_hash_map<K,V>::make_tree(const std::shared_ptr<node_pool_type>& pool) {
+    return tree_bucket(new splay_tree<K,V>(pool));
+}
+
+//create empty buckets, either flat or trees that allocate their nodes from pool
+template <typename K, typename V>
+std::vector<typename adaptive_hash_map<K,V>::bucket> adaptive_hash_map<K,V>::make_buckets(
+        const size_t bucketCount, const std::shared_ptr<node_pool_type>& pool, const bool flat) {
+    std::vector<bucket> buckets;
+    buckets.reserve(bucketCount);
+    for (size_t i = 0; i < bucketCount; i++) {
+        if (flat) {
+            buckets.emplace_back(std::in_place_type<flat_bucket>);
+        } else {
+            buckets.emplace_back(std::in_place_type<tree_bucket>, make_tree(pool));
+        }
+    }
+    return buckets;
+}
+
+//keep the splay counters of buckets being replaced; bucket i's are added to bucket i % to.size(),
+//so the table's totals survive a resize and each bucket keeps its own when the count is unchanged
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::carry_counters(const std::vector<bucket>& from, std::vector<bucket>& to) {
+#ifdef CS251_SPLAY_STATS
+    for (size_t i = 0; i < from.size(); i++) {
+        const auto* source = tree_of(from[i]);
+        if (source == nullptr) {
+            continue;
+        }
+        if (auto* target = tree_of(to[i % to.size()])) {
+            target->m_counters += source->m_counters;
+        } else {
+            m_flatCounters += source->m_counters;
+        }
+    }
+#else
+    (void)from;
+    (void)to;
+#endif
+}
+
+template <typename K, typename V>
+typename splay_tree<K,V>::tree_node* adaptive_hash_map<K,V>::make_node(K key, std::unique_ptr<V> value) {
+    typename splay_tree<K,V>::tree_node* node = m_pool->allocate();
+    splay_tree<K,V>::set_key(node, std::move(key));
+    node->m_value = std::move(value);
+    return node;
+}
+
+template <typename K, typename V>
+bool adaptive_hash_map<K,V>::key_less(const K& a, const K& b) {
+    return key_compare<K>{}(a, b) < 0;
+}
+
 template <typename K, typename V>
 size_t adaptive_hash_map<K,V>::hash_code(K key) const {
     return key % m_bucketCount;
 }
 
-template <typename K, typename V>void adaptive_hash_map<K,V>::insert(const K& key, std::unique_ptr<V> value) {
-    m_data[hash_code(key)].insert(key, std::move(value));
-    m_numElements++;
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::resize(const size_t bucketCount) {
+    if (bucketCount == 0) {
+        throw std::invalid_argument("adaptive_hash_map needs at least one bucket");
+    }
+    if (bucketCount == m_bucketCount) {
+        return;
+    }
+
+    //tree nodes stay in the shared pool, so they are only relinked; flat entries are grouped by
+    //their new bucket with a counting pass
+    std::vector<node_list> regrouped(bucketCount);
+    entry_list loose;
+    for (auto& entry : m_data) {
+        if (auto* tree = tree_of(entry)) {
+            for (auto node : tree->detach_nodes()) {
+                regrouped[node->m_key % bucketCount].push_back(node);
+            }
+        } else {
+            flat_bucket& flat = std::get<flat_bucket>(entry);
+            for (size_t i = 0; i < flat.m_count; i++) {
+                loose.emplace_back(std::move(flat.m_keys[i]), std::move(flat.m_values[i]));
+            }
+        }
+    }
+    std::vector<size_t> starts(bucketCount + 1, 0);
+    for (const auto& item : loose) {
+        starts[item.first % bucketCount + 1]++;
+    }
+    for (size_t i = 0; i < bucketCount; i++) {
+        starts[i + 1] += starts[i];
+    }
+    entry_list grouped(loose.size());
+    std::vector<size_t> next(starts.begin(), starts.end() - 1);
+    for (auto& item : loose) {
+        grouped[next[item.first % bucketCount]++] = std::move(item);
+    }
+
+    std::vector<bucket> buckets;
+    buckets.reserve(bucketCount);
+    for (size_t i = 0; i < bucketCount; i++) {
+        node_list& nodes = regrouped[i];
+        if (m_flatBuckets && nodes.size() + starts[i + 1] - starts[i] <= flat_capacity) {
+            flat_bucket flat;
+            for (auto node : nodes) {
+                flat_append(flat, std::move(node->m_key), std::move(node->m_value));
+                m_pool->release(node);
+            }
+            for (size_t j = starts[i]; j < starts[i + 1]; j++) {
+                flat_append(flat, std::move(grouped[j].first), std::move(grouped[j].second));
+            }
+            buckets.push_back(std::move(flat));
+            continue;
+        }
+
+        //only flat entries landing in a tree need a node
+        for (size_t j = starts[i]; j < starts[i + 1]; j++) {
+            nodes.push_back(make_node(std::move(grouped[j].first), std::move(grouped[j].second)));
+        }
+        //every old tree bucket contributes an increasing run, and only one does when the new count
+        //is a multiple of the old one
+        auto byKey = [](const auto& a, const auto& b) { return key_less(a->m_key, b->m_key); };
+        if (!std::is_sorted(nodes.begin(), nodes.end(), byKey)) {
+            std::sort(nodes.begin(), nodes.end(), byKey);
+        }
+        tree_bucket tree = make_tree(m_pool);
+        tree->attach_sorted(nodes);
+        buckets.push_back(std::move(tree));
+    }
+    carry_counters(m_data, buckets);
+    m_data = std::move(buckets);
+    m_bucketCount = bucketCount;
+}
+
+template <typename K, typename V>
+float adaptive_hash_map<K,V>::load_factor() const {
+    return static_cast<float>(m_numElements) / static_cast<float>(m_bucketCount);
+}
+
+template <typename K, typename V>
+float adaptive_hash_map<K,V>::max_load_factor() const {
+    return m_maxLoadFactor;
+}
+
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::set_max_load_factor(const float maxLoadFactor) {
+    if (maxLoadFactor < 0.0f) {
+        throw std::invalid_argument("the maximum load factor cannot be negative");
+    }
+    m_maxLoadFactor = maxLoadFactor;
+    grow_to_fit();
+}
+
+//double the bucket count until the load factor is within its maximum; doubling lets every old
+//bucket split in two without sorting
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::grow_to_fit() {
+    if (m_maxLoadFactor <= 0.0f) {
+        return;
+    }
+    size_t bucketCount = m_bucketCount;
+    while (static_cast<float>(m_numElements) > m_maxLoadFactor * static_cast<float>(bucketCount)) {
+        bucketCount *= 2;
+    }
+    resize(bucketCount);
+}
+
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::set_flat_buckets(const bool enabled) {
+    if (enabled == m_flatBuckets) {
+        return;
+    }
+    if (enabled) {
+        m_flatBuckets = true;
+        flatten_all();
+    } else {
+        unflatten_all();
+        m_flatBuckets = false;
+    }
+}
+
+template <typename K, typename V>
+bool adaptive_hash_map<K,V>::flat_buckets() const {
+    return m_flatBuckets;
+}
+
+template <typename K, typename V>
+bool adaptive_hash_map<K,V>::is_flat(const size_t bucket) const {
+    return std::holds_alternative<flat_bucket>(m_data[bucket]);
+}
+
+//the tree of a bucket, or nullptr if it is flat
+template <typename K, typename V>
+splay_tree<K,V>* adaptive_hash_map<K,V>::tree_of(bucket& entry) {
+    tree_bucket* tree = std::get_if<tree_bucket>(&entry);
+    return tree != nullptr ? tree->get() : nullptr;
+}
+
+template <typename K, typename V>
+const splay_tree<K,V>* adaptive_hash_map<K,V>::tree_of(const bucket& entry) {
+    const tree_bucket* tree = std::get_if<tree_bucket>(&entry);
+    return tree != nullptr ? tree->get() : nullptr;
+}
+
+template <typename K, typename V>
+size_t adaptive_hash_map<K,V>::bucket_size(const size_t bucket) const {
+    if (const auto* tree = tree_of(m_data[bucket])) {
+        return tree->size();
+    }
+    return std::get<flat_bucket>(m_data[bucket]).m_count;
+}
+
+//index of key in a flat bucket, or flat_capacity if it is missing
+template <typename K, typename V>
+size_t adaptive_hash_map<K,V>::flat_find(const flat_bucket& flat, const K& key) {
+    for (size_t i = 0; i < flat.m_count; i++) {
+        if (key_compare<K>{}(flat.m_keys[i], key) == 0) {
+            return i;
+        }
+    }
+    return flat_capacity;
+}
+
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::flat_append(flat_bucket& flat, K key, std::unique_ptr<V> value) {
+    flat.m_keys[flat.m_count] = std::move(key);
+    flat.m_values[flat.m_count] = std::move(value);
+    flat.m_count++;
+}
+
+template <typename K, typename V>
+bool adaptive_hash_map<K,V>::bucket_insert(const size_t bucket, const K& key, std::unique_ptr<V> value) {
+    if (auto* tree = tree_of(m_data[bucket])) {
+        return tree->try_insert(key, std::move(value));
+    }
+    flat_bucket& flat = std::get<flat_bucket>(m_data[bucket]);
+    if (flat_find(flat, key) != flat_capacity) {
+        return false;
+    }
+    if (flat.m_count == flat_capacity) {
+        treeify(bucket);
+        return std::get<tree_bucket>(m_data[bucket])->try_insert(key, std::move(value));
+    }
+    flat_append(flat, key, std::move(value));
+    return true;
+}
+
+template <typename K, typename V>
+const std::unique_ptr<V>* adaptive_hash_map<K,V>::bucket_find(const size_t bucket, const K& key) {
+    if (auto* tree = tree_of(m_data[bucket])) {
+        return tree->find(key);
+    }
+    flat_bucket& flat = std::get<flat_bucket>(m_data[bucket]);
+    size_t index = flat_find(flat, key);
+    return index == flat_capacity ? nullptr : &flat.m_values[index];
+}
+
+//the value stored for key, found without splaying, or nullptr if key is missing
+template <typename K, typename V>
+std::unique_ptr<V>* adaptive_hash_map<K,V>::bucket_slot(const size_t bucket, const K& key) {
+    if (auto* tree = tree_of(m_data[bucket])) {
+        auto node = tree->find_node(key);
+        return node == nullptr ? nullptr : &node->m_value;
+    }
+    flat_bucket& flat = std::get<flat_bucket>(m_data[bucket]);
+    size_t index = flat_find(flat, key);
+    return index == flat_capacity ? nullptr : &flat.m_values[index];
+}
+
+template <typename K, typename V>
+std::optional<std::unique_ptr<V>> adaptive_hash_map<K,V>::bucket_extract(const size_t bucket, const K& key) {
+    if (auto* tree = tree_of(m_data[bucket])) {
+        auto value = tree->try_extract(key);
+        if (value && m_flatBuckets && tree->size() <= flat_shrink) {
+            flatten(bucket);
+        }
+        return value;
+    }
+    flat_bucket& flat = std::get<flat_bucket>(m_data[bucket]);
+    size_t index = flat_find(flat, key);
+    if (index == flat_capacity) {
+        return std::nullopt;
+    }
+    //order within a flat bucket does not matter, so the last entry fills the gap
+    std::unique_ptr<V> value = std::move(flat.m_values[index]);
+    size_t last = flat.m_count - 1;
+    flat.m_keys[index] = std::move(flat.m_keys[last]);
+    flat.m_values[index] = std::move(flat.m_values[last]);
+    flat.m_keys[last] = K{};
+    flat.m_count--;
+    return value;
+}
+
+//turn a flat bucket into a tree of its entries
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::treeify(const size_t bucket) {
+    flat_bucket flat = std::move(std::get<flat_bucket>(m_data[bucket]));
+    node_list nodes;
+    for (size_t i = 0; i < flat.m_count; i++) {
+        nodes.push_back(make_node(std::move(flat.m_keys[i]), std::move(flat.m_values[i])));
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const auto& a, const auto& b) { return key_less(a->m_key, b->m_key); });
+    tree_bucket tree = make_tree(m_pool);
+    tree->attach_sorted(nodes);
+    m_data[bucket] = std::move(tree);
+}
+
+//turn a tree bucket of at most flat_capacity entries into a flat one, returning the nodes to the pool
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::flatten(const size_t bucket) {
+    splay_tree<K,V>& tree = *std::get<tree_bucket>(m_data[bucket]);
+#ifdef CS251_SPLAY_STATS
+    m_flatCounters += tree.m_counters;
+#endif
+    flat_bucket flat;
+    for (auto node : tree.detach_nodes()) {
+        flat_append(flat, std::move(node->m_key), std::move(node->m_value));
+        m_pool->release(node);
+    }
+    m_data[bucket] = std::move(flat);
+}
+
+//flatten every tree bucket small enough to fit, if flat buckets are on
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::flatten_all() {
+    if (!m_flatBuckets) {
+        return;
+    }
+    for (size_t i = 0; i < m_bucketCount; i++) {
+        if (!is_flat(i) && bucket_size(i) <= flat_capacity) {
+            flatten(i);
+        }
+    }
+}
+
+//turn every flat bucket into a tree, for when flat buckets are turned off
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::unflatten_all() {
+    for (size_t i = 0; i < m_bucketCount; i++) {
+        if (is_flat(i)) {
+            treeify(i);
+        }
+    }
+}
+
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::insert(const K& key, std::unique_ptr<V> value) {
+    if (!try_insert(key, std::move(value))) {
+        throw duplicate_key();
+    }
 }
 
 template <typename K, typename V>
 const std::unique_ptr<V>& adaptive_hash_map<K,V>::peek(const K& key) {
-	return m_data[hash_code(key)].peek(key);
+    const std::unique_ptr<V>* value = find(key);
+    if (value == nullptr) {
+        throw nonexistent_key();
+    }
+    return *value;
 }
 
 template <typename K, typename V>
 std::unique_ptr<V> adaptive_hash_map<K,V>::extract(const K& key) {
-    auto value = m_data[hash_code(key)].extract(key);
-    m_numElements--;
+    std::optional<std::unique_ptr<V>> value = try_extract(key);
+    if (!value) {
+        throw nonexistent_key();
+    }
+    return std::move(*value);
+}
+
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::remove(const K& key) {
+    if (bucket_extract(hash_code(key), key)) {
+        m_numElements--;
+    }
+}
+
+//advance the expiry sweep by a bounded number of steps
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::expire_some() {
+    if (m_expiry.empty()) {
+        return;
+    }
+    m_expiry.sweep(expiry_index<K>::clock::now(), expiry_index<K>::sweep_budget,
+                   [this](const K& key) { remove(key); });
+}
+
+//reclaim the entry for key if its time-to-live has passed
+template <typename K, typename V>
+bool adaptive_hash_map<K,V>::expire_if_due(const K& key) {
+    if (m_expiry.empty() || !m_expiry.take_expired(key, expiry_index<K>::clock::now())) {
+        return false;
+    }
+    remove(key);
+    return true;
+}
+
+template <typename K, typename V>
+bool adaptive_hash_map<K,V>::try_insert(const K& key, std::unique_ptr<V> value) {
+    expire_some();
+    expire_if_due(key);
+
+    if (!bucket_insert(hash_code(key), key, std::move(value))) {
+        return false;
+    }
+    m_numElements++;
+    if (m_maxLoadFactor > 0.0f && static_cast<float>(m_numElements) > m_maxLoadFactor * static_cast<float>(m_bucketCount)) {
+        resize(m_bucketCount * 2);
+    }
+    return true;
+}
+
+template <typename K, typename V>
+const std::unique_ptr<V>* adaptive_hash_map<K,V>::find(const K& key) {
+    expire_some();
+    if (expire_if_due(key)) {
+        return nullptr;
+    }
+    return bucket_find(hash_code(key), key);
+}
+
+template <typename K, typename V>
+std::optional<std::unique_ptr<V>> adaptive_hash_map<K,V>::try_extract(const K& key) {
+    expire_some();
+    if (expire_if_due(key)) {
+        return std::nullopt;
+    }
+
+    auto value = bucket_extract(hash_code(key), key);
+    if (value) {
+        m_numElements--;
+        if (!m_expiry.empty()) {
+            m_expiry.disarm(key);
+        }
+    }
     return value;
 }
 
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::insert(const K& key, std::unique_ptr<V> value, const std::chrono::steady_clock::duration ttl) {
+    if (!try_insert(key, std::move(value), ttl)) {
+        throw duplicate_key();
+    }
+}
+
+template <typename K, typename V>
+bool adaptive_hash_map<K,V>::try_insert(const K& key, std::unique_ptr<V> value, const std::chrono::steady_clock::duration ttl) {
+    if (!try_insert(key, std::move(value))) {
+        return false;
+    }
+    m_expiry.arm(key, expiry_index<K>::clock::now() + ttl);
+    return true;
+}
+
+template <typename K, typename V>
+bool adaptive_hash_map<K,V>::expire_after(const K& key, const std::chrono::steady_clock::duration ttl) {
+    if (find(key) == nullptr) {
+        return false;
+    }
+    m_expiry.arm(key, expiry_index<K>::clock::now() + ttl);
+    return true;
+}
+
+template <typename K, typename V>
+size_t adaptive_hash_map<K,V>::purge_expired() {
+    size_t before = m_numElements;
+    m_expiry.sweep_all(expiry_index<K>::clock::now(), [this](const K& key) { remove(key); });
+    return before - m_numElements;
+}
+
+//move one incoming entry into this table; a conflict resolved by keeping or overwriting our entry
+//consumes value, and one kept by merge_policy::collect leaves it with the caller
+template <typename K, typename V>
+typename adaptive_hash_map<K,V>::merge_result adaptive_hash_map<K,V>::merge_entry(const K& key, std::unique_ptr<V>& value,
+                                                                                  const merge_policy policy) {
+    size_t bucket = hash_code(key);
+    std::unique_ptr<V>* existing = bucket_slot(bucket, key);
+    if (existing == nullptr) {
+        bucket_insert(bucket, key, std::move(value));
+        return merge_result::moved;
+    }
+    if (policy == merge_policy::collect) {
+        return merge_result::collected;
+    }
+    if (policy == merge_policy::overwrite) {
+        *existing = std::move(value);
+    } else {
+        value.reset();
+    }
+    return merge_result::resolved;
+}
+
+template <typename K, typename V>
+size_t adaptive_hash_map<K,V>::merge(adaptive_hash_map& other, const merge_policy policy) {
+    using time_point = typename expiry_index<K>::clock::time_point;
+    if (&other == this) {
+        return 0;
+    }
+    purge_expired();
+    other.purge_expired();
+    if (other.empty()) {
+        return 0;
+    }
+
+    //note which incoming entries with a time-to-live collide with one of ours, and which of our
+    //deadlines go with the entries that incoming ones without a time-to-live overwrite
+    std::vector<std::tuple<K, time_point, bool>> deadlines;
+    other.m_expiry.for_each([&](const K& key, time_point deadline) {
+        deadlines.emplace_back(key, deadline, bucket_slot(hash_code(key), key) != nullptr);
+    });
+    std::vector<K> overwritten;
+    if (policy == merge_policy::overwrite) {
+        m_expiry.for_each([&](const K& key, time_point) {
+            if (!other.m_expiry.deadline(key) && other.bucket_slot(other.hash_code(key), key) != nullptr) {
+                overwritten.push_back(key);
+            }
+        });
+    }
+
+    //take over the slabs of other's pool if only other uses it; its nodes are then ours already,
+    //and other allocates from our pool until the entries it keeps are copied back out below
+    bool takeOver = other.owns_pool();
+    if (takeOver) {
+        m_pool->absorb(*other.m_pool);
+        other.m_pool = m_pool;
+        for (auto& entry : other.m_data) {
+            if (auto* tree = tree_of(entry)) {
+                tree->m_pool = m_pool;
+            }
+        }
+    }
+
+    size_t moved = 0;
+    std::vector<node_list> incoming(m_bucketCount);
+    for (size_t j = 0; j < other.m_bucketCount; j++) {
+        if (flat_bucket* flat = std::get_if<flat_bucket>(&other.m_data[j])) {
+            //flat entries move one at a time, and need a node only if they land in a tree
+            flat_bucket kept;
+            for (size_t i = 0; i < flat->m_count; i++) {
+                merge_result result = merge_entry(flat->m_keys[i], flat->m_values[i], policy);
+                if (result == merge_result::moved) {
+                    moved++;
+                } else if (result == merge_result::collected) {
+                    flat_append(kept, std::move(flat->m_keys[i]), std::move(flat->m_values[i]));
+                }
+            }
+            *flat = std::move(kept);
+            continue;
+        }
+
+        splay_tree<K,V>& tree = *std::get<tree_bucket>(other.m_data[j]);
+        if (other.m_bucketCount == m_bucketCount && !is_flat(j)) {
+            //same hash function - the bucket merges tree-to-tree with its counterpart
+            moved += std::get<tree_bucket>(m_data[j])->merge(tree, policy);
+            continue;
+        }
+        //otherwise regroup the incoming nodes by their bucket in this table
+        for (auto node : tree.detach_nodes()) {
+            incoming[hash_code(node->m_key)].push_back(node);
+        }
+    }
+
+    //conflicts kept by merge_policy::collect go back to other, in nodes from its pool
+    std::vector<node_list> leftovers(other.m_bucketCount);
+    for (size_t i = 0; i < m_bucketCount; i++) {
+        node_list& nodes = incoming[i];
+        if (nodes.empty()) {
+            continue;
+        }
+        if (is_flat(i) && bucket_size(i) + nodes.size() <= flat_capacity) {
+            //the flat bucket has room for them all, so the entries move and the nodes are released
+            for (auto node : nodes) {
+                merge_result result = merge_entry(node->m_key, node->m_value, policy);
+                if (result == merge_result::collected) {
+                    leftovers[other.hash_code(node->m_key)].push_back(node);
+                } else {
+                    moved += result == merge_result::moved;
+                    other.m_pool->release(node);
+                }
+            }
+            continue;
+        }
+
+        if (is_flat(i)) {
+            treeify(i);
+        }
+        splay_tree<K,V>& tree = *std::get<tree_bucket>(m_data[i]);
+        for (auto& node : nodes) {
+            node = tree.adopt(node, *other.m_pool);
+        }
+        std::sort(nodes.begin(), nodes.end(), [](const auto& a, const auto& b) { return key_less(a->m_key, b->m_key); });
+        node_list mine = tree.detach_nodes();
+        node_list merged;
+        node_list conflicts;
+        moved += tree.merge_sorted(mine, nodes, *m_pool, policy, merged, conflicts);
+        tree.attach_sorted(merged);
+        for (auto node : conflicts) {
+            size_t bucket = other.hash_code(node->m_key);
+            leftovers[bucket].push_back(std::get<tree_bucket>(other.m_data[bucket])->adopt(node, *m_pool));
+        }
+    }
+    for (size_t i = 0; i < other.m_bucketCount; i++) {
+        if (leftovers[i].empty()) {
+            continue;
+        }
+        std::sort(leftovers[i].begin(), leftovers[i].end(),
+                  [](const auto& a, const auto& b) { return key_less(a->m_key, b->m_key); });
+        std::get<tree_bucket>(other.m_data[i])->attach_sorted(leftovers[i]);
+    }
+
+    //the time-to-live follows the entry unless our entry is kept
+    for (const auto& [key, deadline, conflict] : deadlines) {
+        if (conflict && policy == merge_policy::collect) {
+            continue;
+        }
+        if (!conflict || policy == merge_policy::overwrite) {
+            m_expiry.arm(key, deadline);
+        }
+        other.m_expiry.disarm(key);
+    }
+    for (const K& key : overwritten) {
+        m_expiry.disarm(key);
+    }
+
+    m_numElements += moved;
+    other.m_numElements = 0;
+    for (size_t i = 0; i < other.m_bucketCount; i++) {
+        other.m_numElements += other.bucket_size(i);
+    }
+    flatten_all();
+    other.flatten_all();
+    if (takeOver) {
+        //only the conflicts other keeps are copied, into a pool of its own again
+        other.m_pool = std::make_shared<node_pool_type>();
+        for (auto& entry : other.m_data) {
+            if (auto* tree = tree_of(entry)) {
+                node_list nodes = tree->detach_nodes();
+                tree->m_pool = other.m_pool;
+                for (auto& node : nodes) {
+                    node = tree->adopt(node, *m_pool);
+                }
+                tree->attach_sorted(nodes);
+            }
+        }
+    }
+    grow_to_fit();
+    return moved;
+}
+
+template <typename K, typename V>
+size_t adaptive_hash_map<K,V>::merge(adaptive_hash_map&& other, const merge_policy policy) {
+    return merge(other, policy);
+}
+
 template <typename K, typename V>
 size_t adaptive_hash_map<K,V>::size() const {
     return m_numElements;
@@ -100,4 +1016,165 @@ bool adaptive_hash_map<K,V>::empty() const {
     return m_numElements == 0;
 }
 
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::clear() {
+    //dropping the buckets releases the shared pool, and with it every node
+    std::shared_ptr<node_pool_type> pool = std::make_shared<node_pool_type>();
+    std::vector<bucket> buckets = make_buckets(m_bucketCount, pool, m_flatBuckets);
+    carry_counters(m_data, buckets);
+    forget_buckets();
+    m_data = std::move(buckets);
+    m_pool = std::move(pool);
+    m_numElements = 0;
+    m_expiry = expiry_index<K>();
+}
+
+template <typename K, typename V>
+splay_stats adaptive_hash_map<K,V>::stats() const {
+    splay_stats stats;
+    for (const auto& entry : m_data) {
+        if (const auto* tree = tree_of(entry)) {
+            stats += tree->stats();
+        } else {
+            stats.m_flat += std::get<flat_bucket>(entry).m_count;
+        }
+    }
+    stats.m_slabs = m_pool->slab_count();
+#ifdef CS251_SPLAY_STATS
+    stats.m_counters += m_flatCounters;
+#endif
+    return stats;
+}
+
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::reset_stats() {
+    for (auto& entry : m_data) {
+        if (auto* tree = tree_of(entry)) {
+            tree->reset_stats();
+        }
+    }
+    m_flatCounters = splay_counters();
+}
+
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw serialization_error("cannot open " + path + " for writing");
+    }
+    save(out);
+    out.close();
+    if (!out) {
+        throw serialization_error("cannot write " + path);
+    }
+}
+
+//write a flat bucket as splay_tree writes its nodes, shaped as a chain of right children in key
+//order, so the format does not depend on the setting
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::write_flat(std::ostream& out, const flat_bucket& flat) {
+    using tree_type = splay_tree<K,V>;
+    std::array<size_t, flat_capacity> order {};
+    for (size_t i = 0; i < flat.m_count; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.begin() + flat.m_count,
+              [&](size_t a, size_t b) { return key_less(flat.m_keys[a], flat.m_keys[b]); });
+
+    serializer<uint64_t>::write(out, flat.m_count);
+    for (size_t i = 0; i < flat.m_count; i++) {
+        const std::unique_ptr<V>& value = flat.m_values[order[i]];
+        uint8_t shape = (i + 1 < flat.m_count ? tree_type::shape_right : 0) | (value != nullptr ? tree_type::shape_value : 0);
+        serializer<uint8_t>::write(out, shape);
+        serializer<K>::write(out, flat.m_keys[order[i]]);
+        if (value != nullptr) {
+            serializer<V>::write(out, *value);
+        }
+    }
+}
+
+//the header and bucket count, each bucket as splay_tree writes its nodes, then the deadlines as
+//(key, nanoseconds left) pairs
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::save(std::ostream& out) const {
+    using clock = typename expiry_index<K>::clock;
+    out.write(file_magic, sizeof(file_magic));
+    serializer<uint32_t>::write(out, file_version);
+    serializer<uint64_t>::write(out, m_bucketCount);
+    for (const auto& entry : m_data) {
+        if (const auto* tree = tree_of(entry)) {
+            tree->write_nodes(out);
+        } else {
+            write_flat(out, std::get<flat_bucket>(entry));
+        }
+    }
+
+    typename clock::time_point now = clock::now();
+    serializer<uint64_t>::write(out, m_expiry.size());
+    m_expiry.for_each([&](const K& key, typename clock::time_point deadline) {
+        serializer<K>::write(out, key);
+        serializer<int64_t>::write(out, std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count());
+    });
+    if (!out) {
+        throw serialization_error("cannot write the table");
+    }
+}
+
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw serialization_error("cannot open " + path + " for reading");
+    }
+    load(in);
+}
+
+template <typename K, typename V>
+void adaptive_hash_map<K,V>::load(std::istream& in) {
+    using clock = typename expiry_index<K>::clock;
+    char magic[sizeof(file_magic)] = {};
+    in.read(magic, sizeof(magic));
+    uint32_t version = serializer<uint32_t>::read(in);
+    uint64_t bucketCount = serializer<uint64_t>::read(in);
+    if (!in || !std::equal(magic, magic + sizeof(magic), file_magic) || version != file_version || bucketCount == 0) {
+        throw serialization_error("not a saved adaptive_hash_map");
+    }
+
+    //build the new table aside, so a failed read leaves this one untouched; the buckets grow with
+    //the data actually read, so a corrupt count runs out of stream instead of allocating without bound
+    std::shared_ptr<node_pool_type> pool = std::make_shared<node_pool_type>();
+    std::vector<bucket> buckets;
+    size_t numElements = 0;
+    for (uint64_t i = 0; i < bucketCount; i++) {
+        tree_bucket tree = make_tree(pool);
+        tree->read_nodes(in);
+        numElements += tree->size();
+        buckets.push_back(std::move(tree));
+    }
+
+    expiry_index<K> expiry;
+    typename clock::time_point now = clock::now();
+    uint64_t deadlines = serializer<uint64_t>::read(in);
+    for (uint64_t i = 0; i < deadlines && in; i++) {
+        K key = serializer<K>::read(in);
+        int64_t left = serializer<int64_t>::read(in);
+        expiry.arm(key, now + std::chrono::duration_cast<typename clock::duration>(std::chrono::nanoseconds(left)));
+    }
+    if (!in) {
+        throw serialization_error("saved table is truncated");
+    }
+
+    carry_counters(m_data, buckets);
+    forget_buckets();
+    m_data = std::move(buckets);
+    m_pool = std::move(pool);
+    m_bucketCount = static_cast<size_t>(bucketCount);
+    m_numElements = numElements;
+    m_expiry = std::move(expiry);
+    flatten_all();
+    //entries that had expired when the table was saved go at once
+    purge_expired();
+    grow_to_fit();
+}
+
 }
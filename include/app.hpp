@@ -1,5 +1,9 @@
 #pragma once
 #include <iostream>
+#include <compare>
+#include "key_prefix.hpp"
+#include "serializer.hpp"
+#include "prefix_scan.hpp"
 
 // Custom name class
 class name {
@@ -16,6 +20,8 @@ public:
 	bool operator>(const name& other) const;
 	bool operator<=(const name& other) const;
 	bool operator>=(const name& other) const;
+	// Three-way comparison in the order of operator<, scanning each string once
+	std::strong_ordering operator<=>(const name& other) const;
 	size_t operator%(size_t m) const;
 };
 
@@ -30,6 +36,36 @@ template <> struct hash<name> {
 };
 }
 
+// Names sort by last name first, so the prefix of the last name preserves their order
+namespace cs251 {
+template <> struct key_prefix<name> {
+	using value_type = uint64_t;
+
+	static constexpr bool enabled = true;
+	static value_type of(const name& key) { return string_prefix(key.m_last); }
+};
+
+// Prefix scans over names match the last name, which leads their order
+template <> struct prefix_scan<name> {
+	static constexpr bool enabled = true;
+	static name lowest(const std::string_view prefix) { return name("", std::string(prefix)); }
+	static bool matches(const name& key, const std::string_view prefix) { return key.m_last.starts_with(prefix); }
+};
+
+// Names are saved as their first and last names
+template <> struct serializer<name> {
+	static void write(std::ostream& out, const name& item) {
+		serializer<std::string>::write(out, item.m_first);
+		serializer<std::string>::write(out, item.m_last);
+	}
+	static name read(std::istream& in) {
+		std::string first = serializer<std::string>::read(in);
+		std::string last = serializer<std::string>::read(in);
+		return name(first, last);
+	}
+};
+}
+
 // Comparison operators
 bool name::operator==(const name& other) const {
 	return m_first == other.m_first && m_last == other.m_last;
@@ -39,10 +75,7 @@ bool name::operator!=(const name& other) const {
 }
 // Sort by last name first
 bool name::operator<(const name& other) const {
-	if (m_last == other.m_last)
-		return m_first < other.m_first;
-	else
-		return m_last < other.m_last;
+	return (*this <=> other) < 0;
 }
 bool name::operator>(const name& other) const {
 	return other < *this;
@@ -53,6 +86,11 @@ bool name::operator<=(const name& other) const {
 bool name::operator>=(const name& other) const {
 	return !(*this < other);
 }
+std::strong_ordering name::operator<=>(const name& other) const {
+	if (std::strong_ordering order = m_last <=> other.m_last; order != 0)
+		return order;
+	return m_first <=> other.m_first;
+}
 
 // Modulus operator
 size_t name::operator%(size_t m) const {
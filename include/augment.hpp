@@ -0,0 +1,65 @@
+#pragma once
+#include <memory>
+#include <limits>
+#include <algorithm>
+namespace cs251 {
+
+// Subtree augmentations for splay_tree
+// The tree keeps one aggregate per node, covering the node's whole subtree, and repairs it
+// whenever splaying or removal changes the subtree; an augmentation supplies
+//   value_type                                the aggregate type
+//   identity()                                the aggregate of an empty subtree
+//   of(key, value)                            the aggregate of a single node
+//   combine(left, right)                      the aggregate of two adjacent key ranges
+// combine must be associative and identity() must be its neutral element
+// Aggregates reflect the values as they were inserted, so values must not be changed in place
+
+// The default augmentation - keeps nothing and costs nothing
+struct no_augment {
+	struct value_type {};
+
+	static value_type identity() { return {}; }
+	template <typename K, typename V>
+	static value_type of(const K&, const std::unique_ptr<V>&) { return {}; }
+	static value_type combine(const value_type&, const value_type&) { return {}; }
+};
+
+// Number of nodes in the subtree - enables splay_tree::rank and splay_tree::select
+struct subtree_size {
+	using value_type = size_t;
+
+	static value_type identity() { return 0; }
+	template <typename K, typename V>
+	static value_type of(const K&, const std::unique_ptr<V>&) { return 1; }
+	static value_type combine(const value_type& left, const value_type& right) { return left + right; }
+
+	static size_t count(const value_type& aggregate) { return aggregate; }
+};
+
+// Count, sum, minimum and maximum of the values in the subtree, accumulated as T
+// Enables rank and select as well as splay_tree::range_sum; a null value counts as T()
+template <typename T>
+struct value_stats {
+	struct value_type {
+		size_t m_count = 0;
+		T m_sum = T();
+		T m_min = std::numeric_limits<T>::max();
+		T m_max = std::numeric_limits<T>::lowest();
+	};
+
+	static value_type identity() { return {}; }
+	template <typename K, typename V>
+	static value_type of(const K&, const std::unique_ptr<V>& value) {
+		T item = value ? static_cast<T>(*value) : T();
+		return {1, item, item, item};
+	}
+	static value_type combine(const value_type& left, const value_type& right) {
+		return {left.m_count + right.m_count, left.m_sum + right.m_sum,
+		        std::min(left.m_min, right.m_min), std::max(left.m_max, right.m_max)};
+	}
+
+	static size_t count(const value_type& aggregate) { return aggregate.m_count; }
+	static T sum(const value_type& aggregate) { return aggregate.m_sum; }
+};
+
+}
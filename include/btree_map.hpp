@@ -0,0 +1,609 @@
+#pragma once
+#include <sstream>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <bit>
+#include "common.hpp"
+#include "node_pool.hpp"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+namespace cs251 {
+
+// Whether btree_map searches nodes of 32-bit integer keys with SSE2 compares, which is on wherever
+// SSE2 is available unless built with CS251_BTREE_NO_SIMD
+#if defined(__SSE2__) && !defined(CS251_BTREE_NO_SIMD)
+inline constexpr bool btree_simd_enabled = true;
+#else
+inline constexpr bool btree_simd_enabled = false;
+#endif
+
+// An ordered map with the interface of splay_tree, stored as a B+ tree
+// Every node starts with a cache line holding its key count and as many keys as fit, so a lookup
+// reads one line per level (about log2(n) / 4 levels for int keys, against the log2(n) scattered
+// nodes a binary tree visits) and never restructures the tree
+// Values live only in the leaves; inner nodes hold separator keys and child pointers
+template <typename K, typename V>
+class btree_map {
+public:
+	static constexpr size_t cache_line = 64;
+	// Keys per node: what fits in the first cache line after the header, and at least 7
+	static constexpr size_t node_capacity =
+		std::max<size_t>(7, (cache_line - std::max<size_t>(alignof(K), 4)) / sizeof(K));
+
+	struct alignas(cache_line) btree_node {
+		// Number of keys in use
+		uint16_t m_count = 0;
+		// Whether this is a btree_leaf or a btree_inner
+		bool m_leaf = true;
+		// The sorted keys; in an inner node, the keys under m_children[i] are less than m_keys[i]
+		// and those under m_children[i + 1] are not
+		K m_keys[node_capacity] {};
+	};
+	struct btree_leaf : btree_node {
+		// Pointers to the values of the keys
+		std::unique_ptr<V> m_values[node_capacity] {};
+	};
+	struct btree_inner : btree_node {
+		btree_inner() { this->m_leaf = false; }
+
+		// Pointers to the m_count + 1 children
+		btree_node* m_children[node_capacity + 1] {};
+	};
+
+	// Return a pointer to the root node, or nullptr if the map is empty
+	const btree_node* get_root() const;
+
+	// Default constructor - create an empty map
+	btree_map();
+	// Nodes belong to the map's pools, so maps can be moved but not copied
+	btree_map(const btree_map&) = delete;
+	btree_map& operator=(const btree_map&) = delete;
+	btree_map(btree_map&& other) noexcept;
+	btree_map& operator=(btree_map&& other) noexcept;
+
+	// Insert the key/value pair into the map, if the key doesn't already exist
+	// Throw duplicate_key if the key already exists
+	void insert(const K& key, std::unique_ptr<V> value);
+	// Return a const reference to the value associated with the given key
+	// Throw nonexistent_key if the key is not in the map
+	const std::unique_ptr<V>& peek(const K& key) const;
+	// Remove and return the key-value pair associated with the given key
+	// Throw nonexistent_key if the key is not in the map
+	std::unique_ptr<V> extract(const K& key);
+
+	// Insert the key/value pair and return true, or return false if the key already exists
+	bool try_insert(const K& key, std::unique_ptr<V> value);
+	// Return a pointer to the value associated with the given key, or nullptr if it is missing
+	const std::unique_ptr<V>* find(const K& key) const;
+	// Remove and return the value associated with the given key, or std::nullopt if it is missing
+	std::optional<std::unique_ptr<V>> try_extract(const K& key);
+
+	// Return the minimum key in the map
+	// Throw empty_tree if the map is empty
+	K minimum_key() const;
+	// Return the maximum key in the map
+	// Throw empty_tree if the map is empty
+	K maximum_key() const;
+
+	// Remove every element, freeing the nodes a slab at a time
+	void clear();
+
+	// Return whether the map is currently empty
+	bool empty() const;
+	// Return the current number of elements in the map
+	size_t size() const;
+	// Return the number of levels of nodes, 0 if the map is empty
+	size_t height() const;
+
+private:
+	btree_node* m_root = nullptr;
+	node_pool<btree_leaf> m_leaves {};
+	node_pool<btree_inner> m_inners {};
+	size_t m_numElements = 0;
+
+	// Fewest keys a node other than the root may hold
+	static constexpr size_t leaf_min = node_capacity / 2;
+	static constexpr size_t inner_min = (node_capacity - 1) / 2;
+	// Keys searched with SSE2, whose nodes have the header in the first lane and a key in each other lane
+	static constexpr bool simd_keys = btree_simd_enabled && std::is_integral_v<K> && std::is_signed_v<K>
+	                                  && sizeof(K) == 4 && node_capacity == cache_line / sizeof(K) - 1;
+
+	static btree_leaf* as_leaf(btree_node* node);
+	static btree_inner* as_inner(btree_node* node);
+	static const btree_leaf* as_leaf(const btree_node* node);
+	static const btree_inner* as_inner(const btree_node* node);
+	static size_t min_count(const btree_node* node);
+	static size_t rank(const btree_node* node, const K& key);
+	static size_t child_index(const btree_node* node, const K& key);
+	const btree_leaf* find_leaf(const K& key, size_t& position) const;
+	void release(btree_node* node);
+
+	// Insertion splits full nodes on the way back up; a node that splits returns its new right
+	// sibling and sets separator to the key that goes up to the parent
+	btree_node* insert_into(btree_node* node, const K& key, std::unique_ptr<V>& value, K& separator, bool& inserted);
+	btree_node* insert_leaf(btree_leaf* leaf, size_t position, const K& key, std::unique_ptr<V> value, K& separator);
+	btree_node* insert_inner(btree_inner* inner, size_t child, K key, btree_node* sibling, K& separator);
+	static void put_leaf(btree_leaf* leaf, size_t position, const K& key, std::unique_ptr<V> value);
+	static void put_inner(btree_inner* inner, size_t child, K key, btree_node* sibling);
+
+	// Removal refills a node that fell below its minimum from a sibling, or merges the two
+	bool erase_from(btree_node* node, const K& key, std::optional<std::unique_ptr<V>>& value);
+	void rebalance(btree_inner* parent, size_t child);
+	static void borrow_left(btree_inner* parent, size_t child);
+	static void borrow_right(btree_inner* parent, size_t child);
+	void merge_children(btree_inner* parent, size_t child);
+};
+
+template <typename K, typename V>
+const typename btree_map<K,V>::btree_node* btree_map<K,V>::get_root() const {
+	return m_root;
+}
+
+template <typename K, typename V>
+btree_map<K,V>::btree_map() {
+    m_numElements = 0;
+}
+
+template <typename K, typename V>
+btree_map<K,V>::btree_map(btree_map&& other) noexcept
+    : m_root(std::exchange(other.m_root, nullptr)), m_leaves(std::move(other.m_leaves)),
+      m_inners(std::move(other.m_inners)), m_numElements(std::exchange(other.m_numElements, 0)) {}
+
+template <typename K, typename V>
+btree_map<K,V>& btree_map<K,V>::operator=(btree_map&& other) noexcept {
+    if (this != &other) {
+        m_root = std::exchange(other.m_root, nullptr);
+        m_leaves = std::move(other.m_leaves);
+        m_inners = std::move(other.m_inners);
+        m_numElements = std::exchange(other.m_numElements, 0);
+    }
+    return *this;
+}
+
+template <typename K, typename V>
+typename btree_map<K,V>::btree_leaf* btree_map<K,V>::as_leaf(btree_node* node) {
+    return static_cast<btree_leaf*>(node);
+}
+
+template <typename K, typename V>
+typename btree_map<K,V>::btree_inner* btree_map<K,V>::as_inner(btree_node* node) {
+    return static_cast<btree_inner*>(node);
+}
+
+template <typename K, typename V>
+const typename btree_map<K,V>::btree_leaf* btree_map<K,V>::as_leaf(const btree_node* node) {
+    return static_cast<const btree_leaf*>(node);
+}
+
+template <typename K, typename V>
+const typename btree_map<K,V>::btree_inner* btree_map<K,V>::as_inner(const btree_node* node) {
+    return static_cast<const btree_inner*>(node);
+}
+
+template <typename K, typename V>
+size_t btree_map<K,V>::min_count(const btree_node* node) {
+    return node->m_leaf ? leaf_min : inner_min;
+}
+
+//return the number of keys of node less than key
+template <typename K, typename V>
+size_t btree_map<K,V>::rank(const btree_node* node, const K& key) {
+    if constexpr (simd_keys) {
+#if defined(__SSE2__) && !defined(CS251_BTREE_NO_SIMD)
+        //compare the whole first line at once, and count the lanes holding keys in use
+        static_assert(offsetof(btree_node, m_keys) == sizeof(K));
+        const __m128i* line = reinterpret_cast<const __m128i*>(node);
+        const __m128i target = _mm_set1_epi32(static_cast<int32_t>(key));
+        uint32_t less = 0;
+        for (size_t i = 0; i < cache_line / sizeof(__m128i); i++) {
+            __m128i lanes = _mm_cmplt_epi32(_mm_load_si128(line + i), target);
+            less |= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(lanes))) << (4 * i);
+        }
+        //the keys are sorted, so the lanes less than key form a run from the first key
+        return std::countr_one((less >> 1) & ((1u << node->m_count) - 1));
+#endif
+    } else if constexpr (std::is_arithmetic_v<K>) {
+        //a branch-free scan is cheaper than a binary search over one cache line
+        size_t less = 0;
+        for (size_t i = 0; i < node->m_count; i++) {
+            less += node->m_keys[i] < key;
+        }
+        return less;
+    } else {
+        return std::lower_bound(node->m_keys, node->m_keys + node->m_count, key) - node->m_keys;
+    }
+}
+
+//return the child of the inner node whose subtree would hold key
+template <typename K, typename V>
+size_t btree_map<K,V>::child_index(const btree_node* node, const K& key) {
+    size_t position = rank(node, key);
+    //a key equal to a separator lives to its right
+    if (position < node->m_count && !(key < node->m_keys[position])) {
+        position++;
+    }
+    return position;
+}
+
+//return the leaf where key is or would be, with position set to its index there
+template <typename K, typename V>
+const typename btree_map<K,V>::btree_leaf* btree_map<K,V>::find_leaf(const K& key, size_t& position) const {
+    const btree_node* current = m_root;
+    while (!current->m_leaf) {
+        current = as_inner(current)->m_children[child_index(current, key)];
+    }
+    position = rank(current, key);
+    return as_leaf(current);
+}
+
+template <typename K, typename V>
+void btree_map<K,V>::release(btree_node* node) {
+    if (node->m_leaf) {
+        m_leaves.release(as_leaf(node));
+    } else {
+        m_inners.release(as_inner(node));
+    }
+}
+
+template <typename K, typename V>
+void btree_map<K,V>::insert(const K& key, std::unique_ptr<V> value) {
+    if (!try_insert(key, std::move(value))) {
+        throw duplicate_key();
+    }
+}
+
+template <typename K, typename V>
+const std::unique_ptr<V>& btree_map<K,V>::peek(const K& key) const {
+    const std::unique_ptr<V>* value = find(key);
+    if (value == nullptr) {
+        throw nonexistent_key();
+    }
+    return *value;
+}
+
+template <typename K, typename V>
+std::unique_ptr<V> btree_map<K,V>::extract(const K& key) {
+    std::optional<std::unique_ptr<V>> value = try_extract(key);
+    if (!value) {
+        throw nonexistent_key();
+    }
+    return std::move(*value);
+}
+
+template <typename K, typename V>
+bool btree_map<K,V>::try_insert(const K& key, std::unique_ptr<V> value) {
+    if (m_root == nullptr) {
+        m_root = m_leaves.allocate();
+    }
+
+    K separator {};
+    bool inserted = false;
+    btree_node* sibling = insert_into(m_root, key, value, separator, inserted);
+    if (sibling != nullptr) {
+        //the root split, so the tree grows a level
+        btree_inner* root = m_inners.allocate();
+        root->m_keys[0] = std::move(separator);
+        root->m_count = 1;
+        root->m_children[0] = m_root;
+        root->m_children[1] = sibling;
+        m_root = root;
+    }
+    if (inserted) {
+        m_numElements++;
+    }
+    return inserted;
+}
+
+template <typename K, typename V>
+typename btree_map<K,V>::btree_node* btree_map<K,V>::insert_into(btree_node* node, const K& key,
+                                                                 std::unique_ptr<V>& value, K& separator,
+                                                                 bool& inserted) {
+    if (node->m_leaf) {
+        size_t position = rank(node, key);
+        if (position < node->m_count && !(key < node->m_keys[position])) {
+            return nullptr;
+        }
+        inserted = true;
+        return insert_leaf(as_leaf(node), position, key, std::move(value), separator);
+    }
+
+    btree_inner* inner = as_inner(node);
+    size_t child = child_index(inner, key);
+    K childSeparator {};
+    btree_node* sibling = insert_into(inner->m_children[child], key, value, childSeparator, inserted);
+    if (sibling == nullptr) {
+        return nullptr;
+    }
+    return insert_inner(inner, child, std::move(childSeparator), sibling, separator);
+}
+
+template <typename K, typename V>
+typename btree_map<K,V>::btree_node* btree_map<K,V>::insert_leaf(btree_leaf* leaf, const size_t position,
+                                                                 const K& key, std::unique_ptr<V> value,
+                                                                 K& separator) {
+    if (leaf->m_count < node_capacity) {
+        put_leaf(leaf, position, key, std::move(value));
+        return nullptr;
+    }
+
+    //split the full leaf in two, then insert into the half the key belongs to
+    btree_leaf* right = m_leaves.allocate();
+    const size_t keep = (node_capacity + 1) / 2;
+    std::move(leaf->m_keys + keep, leaf->m_keys + node_capacity, right->m_keys);
+    std::move(leaf->m_values + keep, leaf->m_values + node_capacity, right->m_values);
+    leaf->m_count = keep;
+    right->m_count = node_capacity - keep;
+
+    if (position <= keep) {
+        put_leaf(leaf, position, key, std::move(value));
+    } else {
+        put_leaf(right, position - keep, key, std::move(value));
+    }
+    separator = right->m_keys[0];
+    return right;
+}
+
+template <typename K, typename V>
+typename btree_map<K,V>::btree_node* btree_map<K,V>::insert_inner(btree_inner* inner, const size_t child, K key,
+                                                                  btree_node* sibling, K& separator) {
+    if (inner->m_count < node_capacity) {
+        put_inner(inner, child, std::move(key), sibling);
+        return nullptr;
+    }
+
+    //split the full node around its middle key, which goes up, then add the new child to its half
+    btree_inner* right = m_inners.allocate();
+    const size_t mid = node_capacity / 2;
+    std::move(inner->m_keys + mid + 1, inner->m_keys + node_capacity, right->m_keys);
+    std::copy(inner->m_children + mid + 1, inner->m_children + node_capacity + 1, right->m_children);
+    separator = std::move(inner->m_keys[mid]);
+    inner->m_count = mid;
+    right->m_count = node_capacity - mid - 1;
+
+    if (child <= mid) {
+        put_inner(inner, child, std::move(key), sibling);
+    } else {
+        put_inner(right, child - mid - 1, std::move(key), sibling);
+    }
+    return right;
+}
+
+template <typename K, typename V>
+void btree_map<K,V>::put_leaf(btree_leaf* leaf, const size_t position, const K& key, std::unique_ptr<V> value) {
+    std::move_backward(leaf->m_keys + position, leaf->m_keys + leaf->m_count, leaf->m_keys + leaf->m_count + 1);
+    std::move_backward(leaf->m_values + position, leaf->m_values + leaf->m_count,
+                       leaf->m_values + leaf->m_count + 1);
+    leaf->m_keys[position] = key;
+    leaf->m_values[position] = std::move(value);
+    leaf->m_count++;
+}
+
+//add key at index child and sibling to its right, as the child at index child just split
+template <typename K, typename V>
+void btree_map<K,V>::put_inner(btree_inner* inner, const size_t child, K key, btree_node* sibling) {
+    std::move_backward(inner->m_keys + child, inner->m_keys + inner->m_count, inner->m_keys + inner->m_count + 1);
+    std::copy_backward(inner->m_children + child + 1, inner->m_children + inner->m_count + 1,
+                       inner->m_children + inner->m_count + 2);
+    inner->m_keys[child] = std::move(key);
+    inner->m_children[child + 1] = sibling;
+    inner->m_count++;
+}
+
+template <typename K, typename V>
+const std::unique_ptr<V>* btree_map<K,V>::find(const K& key) const {
+    if (m_root == nullptr) {
+        return nullptr;
+    }
+
+    size_t position;
+    const btree_leaf* leaf = find_leaf(key, position);
+    if (position < leaf->m_count && !(key < leaf->m_keys[position])) {
+        return &leaf->m_values[position];
+    }
+    return nullptr;
+}
+
+template <typename K, typename V>
+std::optional<std::unique_ptr<V>> btree_map<K,V>::try_extract(const K& key) {
+    std::optional<std::unique_ptr<V>> value;
+    if (m_root == nullptr || !erase_from(m_root, key, value)) {
+        return std::nullopt;
+    }
+    m_numElements--;
+
+    //a root left without keys gives way to its only child, or to nothing
+    if (m_root->m_count == 0) {
+        btree_node* root = m_root;
+        m_root = root->m_leaf ? nullptr : as_inner(root)->m_children[0];
+        release(root);
+    }
+    return value;
+}
+
+template <typename K, typename V>
+bool btree_map<K,V>::erase_from(btree_node* node, const K& key, std::optional<std::unique_ptr<V>>& value) {
+    if (node->m_leaf) {
+        btree_leaf* leaf = as_leaf(node);
+        size_t position = rank(leaf, key);
+        if (position == leaf->m_count || key < leaf->m_keys[position]) {
+            return false;
+        }
+        value = std::move(leaf->m_values[position]);
+        std::move(leaf->m_keys + position + 1, leaf->m_keys + leaf->m_count, leaf->m_keys + position);
+        std::move(leaf->m_values + position + 1, leaf->m_values + leaf->m_count, leaf->m_values + position);
+        leaf->m_count--;
+        return true;
+    }
+
+    btree_inner* inner = as_inner(node);
+    size_t child = child_index(inner, key);
+    if (!erase_from(inner->m_children[child], key, value)) {
+        return false;
+    }
+    if (inner->m_children[child]->m_count < min_count(inner->m_children[child])) {
+        rebalance(inner, child);
+    }
+    return true;
+}
+
+//bring the child at index child of parent back up to its minimum, taking a key from a sibling that
+//can spare one, or else merging it with a sibling
+template <typename K, typename V>
+void btree_map<K,V>::rebalance(btree_inner* parent, const size_t child) {
+    if (child > 0 && parent->m_children[child - 1]->m_count > min_count(parent->m_children[child - 1])) {
+        borrow_left(parent, child);
+    } else if (child < parent->m_count
+               && parent->m_children[child + 1]->m_count > min_count(parent->m_children[child + 1])) {
+        borrow_right(parent, child);
+    } else if (child > 0) {
+        merge_children(parent, child - 1);
+    } else {
+        merge_children(parent, child);
+    }
+}
+
+//move the last key of the left sibling into the child at index child
+template <typename K, typename V>
+void btree_map<K,V>::borrow_left(btree_inner* parent, const size_t child) {
+    btree_node* node = parent->m_children[child];
+    btree_node* left = parent->m_children[child - 1];
+    std::move_backward(node->m_keys, node->m_keys + node->m_count, node->m_keys + node->m_count + 1);
+
+    if (node->m_leaf) {
+        btree_leaf* leaf = as_leaf(node);
+        btree_leaf* leftLeaf = as_leaf(left);
+        std::move_backward(leaf->m_values, leaf->m_values + leaf->m_count, leaf->m_values + leaf->m_count + 1);
+        leaf->m_keys[0] = std::move(leftLeaf->m_keys[leftLeaf->m_count - 1]);
+        leaf->m_values[0] = std::move(leftLeaf->m_values[leftLeaf->m_count - 1]);
+        parent->m_keys[child - 1] = leaf->m_keys[0];
+    } else {
+        //the separator comes down and the left sibling's last key goes up in its place
+        btree_inner* inner = as_inner(node);
+        btree_inner* leftInner = as_inner(left);
+        std::copy_backward(inner->m_children, inner->m_children + inner->m_count + 1,
+                           inner->m_children + inner->m_count + 2);
+        inner->m_keys[0] = std::move(parent->m_keys[child - 1]);
+        inner->m_children[0] = leftInner->m_children[leftInner->m_count];
+        parent->m_keys[child - 1] = std::move(leftInner->m_keys[leftInner->m_count - 1]);
+    }
+    node->m_count++;
+    left->m_count--;
+}
+
+//move the first key of the right sibling into the child at index child
+template <typename K, typename V>
+void btree_map<K,V>::borrow_right(btree_inner* parent, const size_t child) {
+    btree_node* node = parent->m_children[child];
+    btree_node* right = parent->m_children[child + 1];
+
+    if (node->m_leaf) {
+        btree_leaf* leaf = as_leaf(node);
+        btree_leaf* rightLeaf = as_leaf(right);
+        leaf->m_keys[leaf->m_count] = std::move(rightLeaf->m_keys[0]);
+        leaf->m_values[leaf->m_count] = std::move(rightLeaf->m_values[0]);
+        std::move(rightLeaf->m_values + 1, rightLeaf->m_values + rightLeaf->m_count, rightLeaf->m_values);
+        std::move(right->m_keys + 1, right->m_keys + right->m_count, right->m_keys);
+        parent->m_keys[child] = right->m_keys[0];
+    } else {
+        //the separator comes down and the right sibling's first key goes up in its place
+        btree_inner* inner = as_inner(node);
+        btree_inner* rightInner = as_inner(right);
+        inner->m_keys[inner->m_count] = std::move(parent->m_keys[child]);
+        inner->m_children[inner->m_count + 1] = rightInner->m_children[0];
+        parent->m_keys[child] = std::move(right->m_keys[0]);
+        std::move(right->m_keys + 1, right->m_keys + right->m_count, right->m_keys);
+        std::copy(rightInner->m_children + 1, rightInner->m_children + rightInner->m_count + 1,
+                  rightInner->m_children);
+    }
+    node->m_count++;
+    right->m_count--;
+}
+
+//merge the child at index child + 1 of parent into the child at index child, and drop their separator
+template <typename K, typename V>
+void btree_map<K,V>::merge_children(btree_inner* parent, const size_t child) {
+    btree_node* left = parent->m_children[child];
+    btree_node* right = parent->m_children[child + 1];
+
+    if (left->m_leaf) {
+        std::move(right->m_keys, right->m_keys + right->m_count, left->m_keys + left->m_count);
+        std::move(as_leaf(right)->m_values, as_leaf(right)->m_values + right->m_count,
+                  as_leaf(left)->m_values + left->m_count);
+        left->m_count += right->m_count;
+    } else {
+        left->m_keys[left->m_count] = std::move(parent->m_keys[child]);
+        std::move(right->m_keys, right->m_keys + right->m_count, left->m_keys + left->m_count + 1);
+        std::copy(as_inner(right)->m_children, as_inner(right)->m_children + right->m_count + 1,
+                  as_inner(left)->m_children + left->m_count + 1);
+        left->m_count += right->m_count + 1;
+    }
+    release(right);
+
+    std::move(parent->m_keys + child + 1, parent->m_keys + parent->m_count, parent->m_keys + child);
+    std::copy(parent->m_children + child + 2, parent->m_children + parent->m_count + 1,
+              parent->m_children + child + 1);
+    parent->m_count--;
+}
+
+template <typename K, typename V>
+K btree_map<K,V>::minimum_key() const {
+    if (m_numElements == 0) {
+        throw empty_tree();
+    }
+
+    const btree_node* current = m_root;
+    while (!current->m_leaf) {
+        current = as_inner(current)->m_children[0];
+    }
+    return current->m_keys[0];
+}
+
+template <typename K, typename V>
+K btree_map<K,V>::maximum_key() const {
+    if (m_numElements == 0) {
+        throw empty_tree();
+    }
+
+    const btree_node* current = m_root;
+    while (!current->m_leaf) {
+        current = as_inner(current)->m_children[current->m_count];
+    }
+    return current->m_keys[current->m_count - 1];
+}
+
+template <typename K, typename V>
+void btree_map<K,V>::clear() {
+    //every node belongs to the pools, so the nodes go back with their slabs
+    m_leaves = node_pool<btree_leaf>();
+    m_inners = node_pool<btree_inner>();
+    m_root = nullptr;
+    m_numElements = 0;
+}
+
+template <typename K, typename V>
+bool btree_map<K,V>::empty() const {
+    return m_root == nullptr;
+}
+
+template <typename K, typename V>
+size_t btree_map<K,V>::size() const {
+    return m_numElements;
+}
+
+template <typename K, typename V>
+size_t btree_map<K,V>::height() const {
+    size_t levels = 0;
+    for (const btree_node* current = m_root; current != nullptr; levels++) {
+        current = current->m_leaf ? nullptr : as_inner(current)->m_children[0];
+    }
+    return levels;
+}
+
+}
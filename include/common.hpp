@@ -0,0 +1,26 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+namespace cs251 {
+
+// Custom exception classes
+class duplicate_key : public std::runtime_error {
+	public: duplicate_key() : std::runtime_error("Duplicate key!") {} };
+class nonexistent_key : public std::runtime_error {
+	public: nonexistent_key() : std::runtime_error("Key does not exist!") {} };
+class empty_tree : public std::runtime_error {
+	public: empty_tree() : std::runtime_error("Tree is empty!") {} };
+class serialization_error : public std::runtime_error {
+	public: serialization_error(const std::string& what) : std::runtime_error(what) {} };
+
+// How merge resolves a key that exists in both containers
+enum class merge_policy {
+	// Keep the destination value and discard the incoming one
+	keep_existing,
+	// Replace the destination value with the incoming one
+	overwrite,
+	// Leave the conflicting entry behind in the source container
+	collect
+};
+
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <map>
+#include <chrono>
+#include <optional>
+#include <unordered_map>
+#include <functional>
+#include <limits>
+namespace cs251 {
+
+// Per-key expiry deadlines for the hash maps, kept in deadline order so that expired keys can
+// be reclaimed a few at a time instead of with a full-table scan
+// A sweep only ever looks at keys that have already expired, however many far-future deadlines
+// the index holds, and re-arming a key replaces its entry rather than leaving a stale one behind
+template <typename K>
+class expiry_index {
+public:
+	using clock = std::chrono::steady_clock;
+
+	// Expired keys reclaimed by each map operation
+	static constexpr size_t sweep_budget = 8;
+
+	expiry_index() = default;
+	// The index refers into its own order, so it can be moved but not copied
+	expiry_index(const expiry_index&) = delete;
+	expiry_index& operator=(const expiry_index&) = delete;
+	expiry_index(expiry_index&&) noexcept = default;
+	expiry_index& operator=(expiry_index&&) noexcept = default;
+
+	// Set or replace the deadline of key
+	void arm(const K& key, clock::time_point deadline);
+	// Remove the deadline of key, if any
+	void disarm(const K& key);
+	// Return the deadline of key, or std::nullopt if it has none
+	std::optional<clock::time_point> deadline(const K& key) const;
+	// If key has expired by now, remove its deadline and return true
+	bool take_expired(const K& key, clock::time_point now);
+
+	// Call expire(key) for at most budget keys that have expired by now, earliest deadline
+	// first, after removing their deadlines
+	template <typename Fn> void sweep(clock::time_point now, size_t budget, Fn expire);
+	// Call expire(key) for every key that has expired by now, after removing its deadline
+	template <typename Fn> void sweep_all(clock::time_point now, Fn expire);
+
+	// Call fn(key, deadline) for every key with a deadline
+	template <typename Fn> void for_each(Fn fn) const;
+
+	// Return the number of keys with a deadline
+	size_t size() const;
+	// Return whether no key has a deadline
+	bool empty() const;
+
+private:
+	using order_type = std::multimap<clock::time_point, K>;
+
+	// Hash keys with the same operator% the hash maps use, so no std::hash is required
+	struct key_hash {
+		size_t operator()(const K& key) const { return key % std::numeric_limits<size_t>::max(); }
+	};
+
+	// Every deadline, earliest first, and the position of each key's deadline in that order
+	order_type m_order {};
+	std::unordered_map<K, typename order_type::iterator, key_hash> m_deadlines {};
+};
+
+template <typename K>
+void expiry_index<K>::arm(const K& key, const clock::time_point deadline) {
+    auto it = m_deadlines.find(key);
+    if (it != m_deadlines.end()) {
+        m_order.erase(it->second);
+        it->second = m_order.emplace(deadline, key);
+    } else {
+        m_deadlines.emplace(key, m_order.emplace(deadline, key));
+    }
+}
+
+template <typename K>
+void expiry_index<K>::disarm(const K& key) {
+    auto it = m_deadlines.find(key);
+    if (it != m_deadlines.end()) {
+        m_order.erase(it->second);
+        m_deadlines.erase(it);
+    }
+}
+
+template <typename K>
+std::optional<typename expiry_index<K>::clock::time_point> expiry_index<K>::deadline(const K& key) const {
+    auto it = m_deadlines.find(key);
+    if (it == m_deadlines.end()) {
+        return std::nullopt;
+    }
+    return it->second->first;
+}
+
+template <typename K>
+bool expiry_index<K>::take_expired(const K& key, const clock::time_point now) {
+    auto it = m_deadlines.find(key);
+    if (it == m_deadlines.end() || it->second->first > now) {
+        return false;
+    }
+    m_order.erase(it->second);
+    m_deadlines.erase(it);
+    return true;
+}
+
+template <typename K>
+template <typename Fn>
+void expiry_index<K>::sweep(const clock::time_point now, size_t budget, Fn expire) {
+    while (budget > 0 && !m_order.empty() && m_order.begin()->first <= now) {
+        budget--;
+        K key = std::move(m_order.begin()->second);
+        m_order.erase(m_order.begin());
+        m_deadlines.erase(key);
+        expire(key);
+    }
+}
+
+template <typename K>
+template <typename Fn>
+void expiry_index<K>::sweep_all(const clock::time_point now, Fn expire) {
+    sweep(now, std::numeric_limits<size_t>::max(), expire);
+}
+
+template <typename K>
+template <typename Fn>
+void expiry_index<K>::for_each(Fn fn) const {
+    for (const auto& [deadline, key] : m_order) {
+        fn(key, deadline);
+    }
+}
+
+template <typename K>
+size_t expiry_index<K>::size() const {
+    return m_deadlines.size();
+}
+
+template <typename K>
+bool expiry_index<K>::empty() const {
+    return m_deadlines.empty();
+}
+
+}
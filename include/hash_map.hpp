@@ -3,14 +3,16 @@
 #include <exception>
 #include <vector>
 #include <memory>
+#include <optional>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <stdexcept>
+#include <type_traits>
+#include "common.hpp"
+#include "expiry_index.hpp"
 namespace cs251 {
 
-// Custom exception classes
-class duplicate_key : public std::runtime_error {
-	public: duplicate_key() : std::runtime_error("Duplicate key!") {} };
-class nonexistent_key : public std::runtime_error {
-	public: nonexistent_key() : std::runtime_error("Key does not exist!") {} };
-
 template <typename K, typename V>
 class hash_map {
 public:
@@ -22,8 +24,79 @@ public:
 		std::unique_ptr<V> m_value{};
 	};
 
-	// Return a constant reference to the hash table vector
-	const std::vector<std::shared_ptr<hash_map_node>>& get_data() const;
+	// The slot array of the table, split into fixed-size segments that are shared
+	// copy-on-write between a table and its snapshots
+	class slot_array {
+	public:
+		// Number of slots in each copy-on-write segment
+		static constexpr size_t segment_size = 64;
+
+		slot_array(size_t size);
+
+		// Return the number of slots
+		size_t size() const;
+		// Return the node stored in slot i, or nullptr if the slot is empty
+		const std::shared_ptr<hash_map_node>& operator[](size_t i) const;
+		// Return whether slot i has been emptied by a removal
+		bool deleted(size_t i) const;
+
+		// Return the slot holding key, or the first free slot of its probe sequence if it is missing
+		// (size() if there is no free slot)
+		size_t probe(const K& key, bool& found) const;
+
+		// Store node in slot i, which stops counting as emptied by a removal
+		void set(size_t i, std::shared_ptr<hash_map_node> node);
+		// Empty slot i and return the node it held
+		std::shared_ptr<hash_map_node> take(size_t i);
+		// Return the node in slot i for modification, first copying it if a snapshot shares it
+		// (a node is shared when its segment is, as well as when it is referred to twice)
+		hash_map_node& write(size_t i);
+
+	private:
+		struct segment {
+			std::array<std::shared_ptr<hash_map_node>, segment_size> m_slots {};
+			std::bitset<segment_size> m_deleted {};
+		};
+
+		// Return segment n, first copying it (and the directory) if a snapshot shares it
+		segment& unshare(size_t n);
+
+		// Directory of segments; copying a slot_array shares everything until the next write
+		std::shared_ptr<std::vector<std::shared_ptr<segment>>> m_segments;
+		size_t m_size;
+	};
+
+	// A read-only, point-in-time view of a hash_map
+	// Taking one is O(1); afterwards the table copies a segment only the first time it writes to it
+	class snapshot_view {
+	public:
+		// Return a pointer to the value associated with the given key, or nullptr if it is missing
+		const std::unique_ptr<V>* find(const K& key) const;
+		// Return a const reference to the value associated with the given key
+		// Throw nonexistent_key if the key is not in the snapshot
+		const std::unique_ptr<V>& peek(const K& key) const;
+		// Call fn(key, value) for every entry in slot order
+		template <typename Fn> void for_each(Fn fn) const;
+
+		// Return the slot array as it was when the snapshot was taken
+		const slot_array& get_data() const;
+		// Return the number of elements in the snapshot
+		size_t size() const;
+		// Return the capacity of the table when the snapshot was taken
+		size_t bucket_count() const;
+		// Return whether the snapshot is empty
+		bool empty() const;
+
+	private:
+		friend class hash_map;
+		snapshot_view(const slot_array& data, size_t numElements);
+
+		slot_array m_data;
+		size_t m_numElements;
+	};
+
+	// Return a constant reference to the hash table slots
+	const slot_array& get_data() const;
 
 	// Default constructor - create a hash map with an initial capacity of 1
 	hash_map();
@@ -47,7 +120,42 @@ public:
 	// Throw nonexistent_key if the key is not in the hash table
 	std::unique_ptr<V> extract(const K& key);
 
-	// Return the current number of elements in the hash table
+	// Non-throwing counterparts of insert/peek/extract for miss-heavy callers
+	// Insert the key/value pair and return true, or return false if the key already exists
+	bool try_insert(const K& key, std::unique_ptr<V> value);
+	// Return a pointer to the value associated with the given key, or nullptr if it is missing
+	const std::unique_ptr<V>* find(const K& key);
+	// Remove and return the value associated with the given key, or std::nullopt if it is missing
+	std::optional<std::unique_ptr<V>> try_extract(const K& key);
+
+	// Time-to-live support - an entry whose ttl has passed behaves as missing and is reclaimed
+	// either when it is next accessed or by a sweep that every operation advances a few steps
+	// Insert the key/value pair with a time-to-live
+	// Throw duplicate_key if the key already exists
+	void insert(const K& key, std::unique_ptr<V> value, std::chrono::steady_clock::duration ttl);
+	// Insert the key/value pair with a time-to-live and return true, or return false if the key already exists
+	bool try_insert(const K& key, std::unique_ptr<V> value, std::chrono::steady_clock::duration ttl);
+	// Set or refresh the time-to-live of an existing key; return false if the key is missing
+	bool expire_after(const K& key, std::chrono::steady_clock::duration ttl);
+	// Reclaim every expired entry now and return how many were reclaimed
+	size_t purge_expired();
+
+	// Move every entry of other into this table, growing the table at most once
+	// Nodes are relinked rather than reallocated; conflicts are resolved by policy
+	// Moved entries keep their time-to-live, as do entries that overwrite one of ours; one without a
+	// time-to-live clears the deadline of the entry it overwrites
+	// Return the number of entries moved into this table
+	size_t merge(hash_map& other, merge_policy policy = merge_policy::keep_existing);
+	size_t merge(hash_map&& other, merge_policy policy = merge_policy::keep_existing);
+
+	// Return a read-only view of the current contents in O(1)
+	// The view keeps every value as it was: the table copies an entry the view shares before
+	// changing it or handing out its value through peek/find, so V must be copyable
+	// Entries that expire after the snapshot is taken remain in the view
+	snapshot_view snapshot() const requires std::is_copy_constructible_v<V>;
+
+	// Return the current number of elements in the hash table, including expired entries
+	// that have not been reclaimed yet
 	size_t size() const;
 	// Return the current capacity of the hash table
 	size_t bucket_count() const;
@@ -56,28 +164,185 @@ public:
 
 private:
 	// The array that holds key-value pairs
-	std::vector<std::shared_ptr<hash_map_node>> m_data = {};
+	slot_array m_data;
 
 	// TODO: Add any additional methods or variables here
     size_t m_bucketCount;
     size_t m_numElements;
+    // Slots emptied by a removal since the last rehash; probes for missing keys walk past them
+    size_t m_numDeleted = 0;
+
+    // Deadlines of the entries inserted with a time-to-live
+    expiry_index<K> m_expiry;
+
+    void place(size_t location, std::shared_ptr<hash_map_node> node);
+    static std::unique_ptr<V> copy_value(const hash_map_node& node);
+    std::shared_ptr<hash_map_node> remove(size_t location);
+    void expire_some();
+    bool expire_if_due(const K& key);
 };
 
 template <typename K, typename V>
-const std::vector<std::shared_ptr<typename hash_map<K,V>::hash_map_node>>& hash_map<K,V>::get_data() const {
+hash_map<K,V>::slot_array::slot_array(const size_t size) {
+    size_t segmentCount = (size + segment_size - 1) / segment_size;
+    m_segments = std::make_shared<std::vector<std::shared_ptr<segment>>>(segmentCount);
+    for (auto& seg : *m_segments) {
+        seg = std::make_shared<segment>();
+    }
+    m_size = size;
+}
+
+template <typename K, typename V>
+size_t hash_map<K,V>::slot_array::size() const {
+    return m_size;
+}
+
+template <typename K, typename V>
+const std::shared_ptr<typename hash_map<K,V>::hash_map_node>& hash_map<K,V>::slot_array::operator[](const size_t i) const {
+    return (*m_segments)[i / segment_size]->m_slots[i % segment_size];
+}
+
+template <typename K, typename V>
+bool hash_map<K,V>::slot_array::deleted(const size_t i) const {
+    return (*m_segments)[i / segment_size]->m_deleted[i % segment_size];
+}
+
+template <typename K, typename V>
+size_t hash_map<K,V>::slot_array::probe(const K& key, bool& found) const {
+    found = false;
+    size_t freeSlot = m_size;
+    size_t location = key % m_size;
+
+    for (size_t step = 0; step < m_size; step++) {
+        const std::shared_ptr<hash_map_node>& node = (*this)[location];
+        if (node != nullptr) {
+            if (node->m_key == key) {
+                found = true;
+                return location;
+            }
+        } else {
+            if (freeSlot == m_size) {
+                freeSlot = location;
+            }
+            //no key was ever probed past a slot that has never been used
+            if (!deleted(location)) {
+                break;
+            }
+        }
+
+        if (location == m_size - 1) {
+            location = 0;
+        } else {
+            location++;
+        }
+    }
+    return freeSlot;
+}
+
+template <typename K, typename V>
+typename hash_map<K,V>::slot_array::segment& hash_map<K,V>::slot_array::unshare(const size_t n) {
+    if (m_segments.use_count() > 1) {
+        m_segments = std::make_shared<std::vector<std::shared_ptr<segment>>>(*m_segments);
+    }
+    std::shared_ptr<segment>& seg = (*m_segments)[n];
+    if (seg.use_count() > 1) {
+        seg = std::make_shared<segment>(*seg);
+    }
+    return *seg;
+}
+
+template <typename K, typename V>
+void hash_map<K,V>::slot_array::set(const size_t i, std::shared_ptr<hash_map_node> node) {
+    segment& seg = unshare(i / segment_size);
+    seg.m_slots[i % segment_size] = std::move(node);
+    seg.m_deleted[i % segment_size] = false;
+}
+
+template <typename K, typename V>
+std::shared_ptr<typename hash_map<K,V>::hash_map_node> hash_map<K,V>::slot_array::take(const size_t i) {
+    segment& seg = unshare(i / segment_size);
+    seg.m_deleted[i % segment_size] = true;
+    return std::move(seg.m_slots[i % segment_size]);
+}
+
+template <typename K, typename V>
+typename hash_map<K,V>::hash_map_node& hash_map<K,V>::slot_array::write(const size_t i) {
+    std::shared_ptr<hash_map_node>& node = unshare(i / segment_size).m_slots[i % segment_size];
+    if (node.use_count() > 1) {
+        std::shared_ptr<hash_map_node> copy = std::make_shared<hash_map_node>();
+        copy->m_key = node->m_key;
+        copy->m_value = copy_value(*node);
+        node = std::move(copy);
+    }
+    return *node;
+}
+
+template <typename K, typename V>
+hash_map<K,V>::snapshot_view::snapshot_view(const slot_array& data, const size_t numElements)
+    : m_data(data), m_numElements(numElements) {}
+
+template <typename K, typename V>
+const std::unique_ptr<V>* hash_map<K,V>::snapshot_view::find(const K& key) const {
+    bool found = false;
+    size_t location = m_data.probe(key, found);
+    if (!found) {
+        return nullptr;
+    }
+    return &m_data[location]->m_value;
+}
+
+template <typename K, typename V>
+const std::unique_ptr<V>& hash_map<K,V>::snapshot_view::peek(const K& key) const {
+    const std::unique_ptr<V>* value = find(key);
+    if (value == nullptr) {
+        throw nonexistent_key();
+    }
+    return *value;
+}
+
+template <typename K, typename V>
+template <typename Fn>
+void hash_map<K,V>::snapshot_view::for_each(Fn fn) const {
+    for (size_t i = 0; i < m_data.size(); i++) {
+        if (m_data[i] != nullptr) {
+            fn(m_data[i]->m_key, m_data[i]->m_value);
+        }
+    }
+}
+
+template <typename K, typename V>
+const typename hash_map<K,V>::slot_array& hash_map<K,V>::snapshot_view::get_data() const {
+    return m_data;
+}
+
+template <typename K, typename V>
+size_t hash_map<K,V>::snapshot_view::size() const {
+    return m_numElements;
+}
+
+template <typename K, typename V>
+size_t hash_map<K,V>::snapshot_view::bucket_count() const {
+    return m_data.size();
+}
+
+template <typename K, typename V>
+bool hash_map<K,V>::snapshot_view::empty() const {
+    return m_numElements == 0;
+}
+
+template <typename K, typename V>
+const typename hash_map<K,V>::slot_array& hash_map<K,V>::get_data() const {
 	return m_data;
 }
 
 template <typename K, typename V>
-hash_map<K,V>::hash_map() {
-    m_data = std::vector<std::shared_ptr<hash_map_node>>(1);
+hash_map<K,V>::hash_map() : m_data(1) {
     m_bucketCount = 1;
     m_numElements = 0;
 }
 
 template <typename K, typename V>
-hash_map<K,V>::hash_map(const size_t bucketCount) {
-    m_data = std::vector<std::shared_ptr<hash_map_node>>(bucketCount);
+hash_map<K,V>::hash_map(const size_t bucketCount) : m_data(bucketCount) {
     m_bucketCount = bucketCount;
     m_numElements = 0;
 }
@@ -94,7 +359,7 @@ void hash_map<K,V>::resize(const size_t bucketCount) {
         m_bucketCount = bucketCount;
         size_t newIndex = 0;
 
-        std::vector<std::shared_ptr<hash_map_node>> resizedTable(bucketCount);
+        slot_array resizedTable(bucketCount);
         //go through every slot in original hash table to rehash
         for (int i = 0; i < originalSize; i++) {
             //if there's an item in the bucket
@@ -109,81 +374,275 @@ void hash_map<K,V>::resize(const size_t bucketCount) {
                         newIndex++;
                     }
                 }
-                resizedTable[newIndex] = m_data[i];
+                resizedTable.set(newIndex, m_data[i]);
             }
         }
-        m_data.swap(resizedTable);
+        m_data = std::move(resizedTable);
+        m_numDeleted = 0;
     }
 }
 
 template <typename K, typename V>
 void hash_map<K,V>::insert(const K& key, std::unique_ptr<V> value) {
-	for (int i = 0; i < m_bucketCount; i++) {
-        if (m_data[i] != nullptr) {
-            if (m_data[i]->m_key == key) {
-                throw duplicate_key();
-            }
+	if (!try_insert(key, std::move(value))) {
+        throw duplicate_key();
+    }
+}
+
+template <typename K, typename V>
+const std::unique_ptr<V>& hash_map<K,V>::peek(const K& key) {
+	const std::unique_ptr<V>* value = find(key);
+    if (value == nullptr) {
+        throw nonexistent_key();
+    }
+    return *value;
+}
+
+template <typename K, typename V>
+std::unique_ptr<V> hash_map<K,V>::extract(const K& key) {
+    std::optional<std::unique_ptr<V>> value = try_extract(key);
+    if (!value) {
+        throw nonexistent_key();
+    }
+    return std::move(*value);
+}
+
+template <typename K, typename V>
+void hash_map<K,V>::place(const size_t location, std::shared_ptr<hash_map_node> node) {
+    if (m_data.deleted(location)) {
+        m_numDeleted--;
+    }
+    m_data.set(location, std::move(node));
+    m_numElements++;
+}
+
+//copy the value of a node that a snapshot shares; only snapshots share nodes, and they need a
+//copyable V, so a table of move-only values never gets here
+template <typename K, typename V>
+std::unique_ptr<V> hash_map<K,V>::copy_value(const hash_map_node& node) {
+    if constexpr (std::is_copy_constructible_v<V>) {
+        return node.m_value ? std::make_unique<V>(*node.m_value) : nullptr;
+    } else {
+        throw std::logic_error("hash_map shares a node whose value cannot be copied");
+    }
+}
+
+template <typename K, typename V>
+std::shared_ptr<typename hash_map<K,V>::hash_map_node> hash_map<K,V>::remove(const size_t location) {
+    m_numElements--;
+    m_numDeleted++;
+    return m_data.take(location);
+}
+
+//advance the expiry sweep by a bounded number of steps
+template <typename K, typename V>
+void hash_map<K,V>::expire_some() {
+    if (m_expiry.empty()) {
+        return;
+    }
+    m_expiry.sweep(expiry_index<K>::clock::now(), expiry_index<K>::sweep_budget, [this](const K& key) {
+        bool found = false;
+        size_t location = m_data.probe(key, found);
+        if (found) {
+            remove(location);
         }
+    });
+}
+
+//reclaim the entry for key if its time-to-live has passed
+template <typename K, typename V>
+bool hash_map<K,V>::expire_if_due(const K& key) {
+    if (m_expiry.empty() || !m_expiry.take_expired(key, expiry_index<K>::clock::now())) {
+        return false;
+    }
+    bool found = false;
+    size_t location = m_data.probe(key, found);
+    if (found) {
+        remove(location);
+    }
+    return true;
+}
+
+template <typename K, typename V>
+bool hash_map<K,V>::try_insert(const K& key, std::unique_ptr<V> value) {
+    expire_some();
+    expire_if_due(key);
+
+    bool found = false;
+    size_t location = m_data.probe(key, found);
+    if (found) {
+        return false;
     }
 
     if (m_numElements == m_bucketCount) {
         resize(m_bucketCount * 2);
+        location = m_data.probe(key, found);
+    } else if (m_bucketCount >= slot_array::segment_size && !m_data.deleted(location)
+               && m_numDeleted > 0 && m_numDeleted * 8 >= m_bucketCount
+               && (m_numElements + m_numDeleted + 1) * 4 > m_bucketCount * 3) {
+        //taking a never-used slot would leave too few to end the probes for missing keys, and
+        //enough slots were emptied by removals to pay for rehashing at the same capacity
+        //(tables under one segment are cheap to probe in full and keep their removed slots)
+        resize(m_bucketCount);
+        location = m_data.probe(key, found);
     }
 
-    size_t location = key % m_bucketCount;
-    //if the slot isn't available - linear probe to take care of collision
-    while (m_data[location] != nullptr) {
-        if (location == m_bucketCount - 1) {                                                      //check if -1 needed
-            location = 0;
-        } else {
-            location++;
-        }
-    }
     //make a new node
-    m_data[location] = std::make_shared<hash_map_node>();
-    m_data[location]->m_key = std::move(key);
-    m_data[location]->m_value = std::move(value);
-    m_numElements++;
+    std::shared_ptr<hash_map_node> node = std::make_shared<hash_map_node>();
+    node->m_key = key;
+    node->m_value = std::move(value);
+    place(location, std::move(node));
+    return true;
 }
 
 template <typename K, typename V>
-const std::unique_ptr<V>& hash_map<K,V>::peek(const K& key) {
-	bool found = false;
-    size_t target = 0;
-    for (int i = 0; i < m_bucketCount; i++) {
-        if (m_data[i] != nullptr) {
-            if (m_data[i]->m_key == key) {
-                found = true;
-                return m_data[i]->m_value;
-            }
-        }
+const std::unique_ptr<V>* hash_map<K,V>::find(const K& key) {
+    expire_some();
+    if (expire_if_due(key)) {
+        return nullptr;
     }
 
+    bool found = false;
+    size_t location = m_data.probe(key, found);
     if (!found) {
-        throw nonexistent_key();
+        return nullptr;
     }
+    //the caller can change the value through the pointer, so a snapshot must not share it
+    return &m_data.write(location).m_value;
 }
 
 template <typename K, typename V>
-std::unique_ptr<V> hash_map<K,V>::extract(const K& key) {
+std::optional<std::unique_ptr<V>> hash_map<K,V>::try_extract(const K& key) {
+    expire_some();
+    if (expire_if_due(key)) {
+        return std::nullopt;
+    }
+
     bool found = false;
-    std::unique_ptr<V> nodeValue;
-    for (int i = 0; i < m_bucketCount; i++) {
-        if (m_data[i] != nullptr) {
-            if (m_data[i]->m_key == key) {
-                found = true;
-                nodeValue = std::move(m_data[i]->m_value);
-                m_data[i] = nullptr;
-            }
+    size_t location = m_data.probe(key, found);
+    if (!found) {
+        return std::nullopt;
+    }
+
+    if (!m_expiry.empty()) {
+        m_expiry.disarm(key);
+    }
+    std::shared_ptr<hash_map_node> node = remove(location);
+    if (node.use_count() > 1) {
+        //a snapshot still refers to this node, so it keeps the original value
+        return copy_value(*node);
+    }
+    return std::move(node->m_value);
+}
+
+template <typename K, typename V>
+void hash_map<K,V>::insert(const K& key, std::unique_ptr<V> value, const std::chrono::steady_clock::duration ttl) {
+    if (!try_insert(key, std::move(value), ttl)) {
+        throw duplicate_key();
+    }
+}
+
+template <typename K, typename V>
+bool hash_map<K,V>::try_insert(const K& key, std::unique_ptr<V> value, const std::chrono::steady_clock::duration ttl) {
+    if (!try_insert(key, std::move(value))) {
+        return false;
+    }
+    m_expiry.arm(key, expiry_index<K>::clock::now() + ttl);
+    return true;
+}
+
+template <typename K, typename V>
+bool hash_map<K,V>::expire_after(const K& key, const std::chrono::steady_clock::duration ttl) {
+    if (find(key) == nullptr) {
+        return false;
+    }
+    m_expiry.arm(key, expiry_index<K>::clock::now() + ttl);
+    return true;
+}
+
+template <typename K, typename V>
+size_t hash_map<K,V>::purge_expired() {
+    size_t before = m_numElements;
+    m_expiry.sweep_all(expiry_index<K>::clock::now(), [this](const K& key) {
+        bool found = false;
+        size_t location = m_data.probe(key, found);
+        if (found) {
+            remove(location);
         }
+    });
+    return before - m_numElements;
+}
+
+template <typename K, typename V>
+size_t hash_map<K,V>::merge(hash_map& other, const merge_policy policy) {
+    if (&other == this) {
+        return 0;
+    }
+    purge_expired();
+    other.purge_expired();
+    if (other.empty()) {
+        return 0;
     }
 
-    if (!found) {
-        throw nonexistent_key();
+    //grow once for the worst case where no keys conflict
+    size_t bucketCount = m_bucketCount;
+    while (bucketCount < m_numElements + other.m_numElements) {
+        bucketCount *= 2;
+    }
+    if (bucketCount != m_bucketCount || m_numDeleted > 0) {
+        //rehashing also clears the slots emptied by removals before the entries move in
+        resize(bucketCount);
     }
 
-    m_numElements--;
-    return nodeValue;
+    size_t moved = 0;
+    for (size_t i = 0; i < other.m_bucketCount; i++) {
+        if (other.m_data[i] == nullptr) {
+            continue;
+        }
+
+        bool found = false;
+        size_t location = m_data.probe(other.m_data[i]->m_key, found);
+        if (found && policy == merge_policy::collect) {
+            //leave the conflicting entry where it is
+            continue;
+        }
+
+        std::shared_ptr<hash_map_node> node = other.remove(i);
+        //the time-to-live follows the entry unless our entry is kept, so an entry without one that
+        //overwrites ours takes our deadline away
+        std::optional<typename expiry_index<K>::clock::time_point> deadline;
+        if (!other.m_expiry.empty()) {
+            deadline = other.m_expiry.deadline(node->m_key);
+            other.m_expiry.disarm(node->m_key);
+        }
+        if (deadline && (!found || policy == merge_policy::overwrite)) {
+            m_expiry.arm(node->m_key, *deadline);
+        } else if (!deadline && found && policy == merge_policy::overwrite) {
+            m_expiry.disarm(node->m_key);
+        }
+        if (!found) {
+            place(location, std::move(node));
+            moved++;
+        } else if (policy == merge_policy::overwrite) {
+            if (node.use_count() > 1) {
+                //a snapshot of other still refers to this node
+                m_data.write(location).m_value = copy_value(*node);
+            } else {
+                m_data.write(location).m_value = std::move(node->m_value);
+            }
+        }
+    }
+    return moved;
+}
+
+template <typename K, typename V>
+size_t hash_map<K,V>::merge(hash_map&& other, const merge_policy policy) {
+    return merge(other, policy);
+}
+
+template <typename K, typename V>
+typename hash_map<K,V>::snapshot_view hash_map<K,V>::snapshot() const requires std::is_copy_constructible_v<V> {
+    return snapshot_view(m_data, m_numElements);
 }
 
 template <typename K, typename V>
@@ -0,0 +1,23 @@
+#pragma once
+#include <compare>
+namespace cs251 {
+
+// Three-way key comparison for splay_tree, which asks for the order of a key and a node's key
+// once per node instead of testing == and then <
+// A comparator is a default-constructible function object, constructed for each comparison, whose
+// operator()(a, b) returns an ordering (std::strong_ordering, std::weak_ordering or a
+// std::partial_ordering that is never unordered) of a against b
+
+// The natural order of K: its operator<=> if it has one, and otherwise its operator== and operator<
+template <typename K>
+struct key_compare {
+	auto operator()(const K& a, const K& b) const {
+		if constexpr (std::three_way_comparable<K>) {
+			return a <=> b;
+		} else {
+			return a == b ? std::weak_ordering::equivalent : a < b ? std::weak_ordering::less : std::weak_ordering::greater;
+		}
+	}
+};
+
+}
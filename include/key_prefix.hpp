@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+namespace cs251 {
+
+// Order-preserving key prefixes for splay_tree
+// A prefix is an unsigned integer cached in each node next to its child pointers, chosen so that
+// of(a) < of(b) implies a < b; comparisons whose prefixes differ then never touch the key itself,
+// and only equal prefixes fall back to the key's own operators
+//   value_type                                the prefix type
+//   of(key)                                   the prefix of key
+
+// The default for keys without a prefix - takes no space and always ties
+template <typename K>
+struct key_prefix {
+	struct value_type {};
+
+	static constexpr bool enabled = false;
+	static value_type of(const K&) { return {}; }
+};
+
+// No prefixes at all, for trees ordered by something other than the natural order of K
+template <typename K>
+struct no_key_prefix {
+	struct value_type {};
+
+	static constexpr bool enabled = false;
+	static value_type of(const K&) { return {}; }
+};
+
+// The first 8 bytes of text, big-endian and zero-padded, so integer order matches byte order
+inline uint64_t string_prefix(const std::string_view text) {
+    unsigned char bytes[8] = {};
+    std::memcpy(bytes, text.data(), std::min<size_t>(text.size(), 8));
+    uint64_t prefix = 0;
+    for (unsigned char byte : bytes) {
+        prefix = prefix << 8 | byte;
+    }
+    return prefix;
+}
+
+template <>
+struct key_prefix<std::string> {
+	using value_type = uint64_t;
+
+	static constexpr bool enabled = true;
+	static value_type of(const std::string& key) { return string_prefix(key); }
+};
+
+}
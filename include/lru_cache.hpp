@@ -0,0 +1,383 @@
+#pragma once
+#include <sstream>
+#include <exception>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <string>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include "common.hpp"
+namespace cs251 {
+
+// Weight of a cached entry against an lru_cache byte budget
+// Overload for key/value types that own heap memory
+template <typename T>
+size_t cache_weight(const T&) {
+	return sizeof(T);
+}
+inline size_t cache_weight(const std::string& item) {
+	return sizeof(std::string) + item.capacity();
+}
+
+// A bounded cache that evicts the least recently used entry when it is full
+// Uses the key % m hash and linear probing of hash_map, but the probe table holds 32-bit entry
+// indices and the recency list is threaded through the entries with 32-bit links, so the
+// bookkeeping per entry is 8 bytes of links plus about 5.3 bytes of probe table, and the weight
+// the entry was charged when a byte budget is set
+template <typename K, typename V>
+class lru_cache {
+	// Marks an empty probe slot or the end of the recency list
+	static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+public:
+	struct lru_cache_entry {
+		// The key of this entry
+		K m_key {};
+		// Pointer to the value of this entry
+		std::unique_ptr<V> m_value {};
+		// Neighbours in the recency list (more and less recently used)
+		uint32_t m_prev = npos;
+		uint32_t m_next = npos;
+		// Weight charged against the byte budget on insert, released when the entry leaves
+		size_t m_weight = 0;
+	};
+
+	// Constructor - create a cache holding at most maxEntries entries and, if maxBytes is not 0,
+	// at most maxBytes of cache_weight(key) + cache_weight(value)
+	lru_cache(size_t maxEntries, size_t maxBytes = 0);
+
+	// Insert the key/value pair as the most recently used entry, evicting as needed
+	// Throw duplicate_key if the key already exists
+	// Throw std::length_error if the entry alone weighs more than maxBytes, leaving the cache unchanged
+	void insert(const K& key, std::unique_ptr<V> value);
+	// Return a const reference to the value associated with the given key and mark it most recently used
+	// Throw nonexistent_key if the key is not in the cache
+	const std::unique_ptr<V>& peek(const K& key);
+	// Remove and return the value associated with the given key
+	// Throw nonexistent_key if the key is not in the cache
+	std::unique_ptr<V> extract(const K& key);
+
+	// Insert the key/value pair and return true, or return false if the key already exists
+	// Throw std::length_error if the entry alone weighs more than maxBytes, leaving the cache unchanged
+	bool try_insert(const K& key, std::unique_ptr<V> value);
+	// Return a pointer to the value associated with the given key and mark it most recently used,
+	// or return nullptr if it is missing
+	const std::unique_ptr<V>* find(const K& key);
+	// Remove and return the value associated with the given key, or std::nullopt if it is missing
+	std::optional<std::unique_ptr<V>> try_extract(const K& key);
+
+	// Return the least recently used key, the next one to be evicted
+	// Throw nonexistent_key if the cache is empty
+	const K& lru_key() const;
+	// Call fn(key, value) for every entry, from the most to the least recently used, without
+	// changing their recency
+	template <typename Fn> void for_each(Fn fn) const;
+
+	// Return the current number of entries in the cache
+	size_t size() const;
+	// Return the maximum number of entries in the cache
+	size_t capacity() const;
+	// Return the weight the cached entries were charged on insert
+	// Values changed in place through peek or find keep the weight they were charged
+	size_t bytes() const;
+	// Return whether the cache is currently empty
+	bool empty() const;
+
+	// Return the number of lookups that found their key
+	size_t hits() const;
+	// Return the number of lookups that missed
+	size_t misses() const;
+	// Return the number of entries evicted to stay within budget
+	size_t evictions() const;
+
+private:
+	// Dense entry storage; removal moves the last entry into the hole
+	std::vector<lru_cache_entry> m_entries {};
+	// Probe table of indices into m_entries, npos when empty
+	std::vector<uint32_t> m_slots {};
+	// Most and least recently used entries
+	uint32_t m_head = npos;
+	uint32_t m_tail = npos;
+
+	size_t m_maxEntries;
+	size_t m_maxBytes;
+	size_t m_bytes = 0;
+	size_t m_hits = 0;
+	size_t m_misses = 0;
+	size_t m_evictions = 0;
+
+	size_t home_slot(const K& key) const;
+	size_t probe(const K& key, bool& found) const;
+	size_t next_slot(size_t slot) const;
+	void unlink(uint32_t index);
+	void push_front(uint32_t index);
+	std::unique_ptr<V> remove(size_t slot);
+	size_t weight(const lru_cache_entry& entry) const;
+};
+
+template <typename K, typename V>
+lru_cache<K,V>::lru_cache(const size_t maxEntries, const size_t maxBytes) {
+    if (maxEntries == 0 || maxEntries >= npos) {
+        throw std::length_error("lru_cache capacity must be between 1 and 2^32 - 2");
+    }
+    m_maxEntries = maxEntries;
+    m_maxBytes = maxBytes;
+    m_entries.reserve(maxEntries);
+    //keep the probe table at most 75% full
+    m_slots = std::vector<uint32_t>(maxEntries + maxEntries / 3 + 1, npos);
+}
+
+template <typename K, typename V>
+size_t lru_cache<K,V>::next_slot(const size_t slot) const {
+    return slot == m_slots.size() - 1 ? 0 : slot + 1;
+}
+
+//scramble the full hash code before reducing it, so runs of sequential keys do not form one long probe cluster
+template <typename K, typename V>
+size_t lru_cache<K,V>::home_slot(const K& key) const {
+    uint64_t hash = static_cast<uint64_t>(key % std::numeric_limits<size_t>::max());
+    hash ^= hash >> 32;
+    hash *= 0x9E3779B97F4A7C15ull;
+    hash ^= hash >> 29;
+    return static_cast<size_t>(hash % m_slots.size());
+}
+
+//return the slot holding key, or the empty slot that ends its probe sequence
+template <typename K, typename V>
+size_t lru_cache<K,V>::probe(const K& key, bool& found) const {
+    size_t slot = home_slot(key);
+    while (m_slots[slot] != npos) {
+        if (m_entries[m_slots[slot]].m_key == key) {
+            found = true;
+            return slot;
+        }
+        slot = next_slot(slot);
+    }
+    found = false;
+    return slot;
+}
+
+template <typename K, typename V>
+void lru_cache<K,V>::unlink(const uint32_t index) {
+    lru_cache_entry& entry = m_entries[index];
+    if (entry.m_prev != npos) {
+        m_entries[entry.m_prev].m_next = entry.m_next;
+    } else {
+        m_head = entry.m_next;
+    }
+    if (entry.m_next != npos) {
+        m_entries[entry.m_next].m_prev = entry.m_prev;
+    } else {
+        m_tail = entry.m_prev;
+    }
+}
+
+template <typename K, typename V>
+void lru_cache<K,V>::push_front(const uint32_t index) {
+    lru_cache_entry& entry = m_entries[index];
+    entry.m_prev = npos;
+    entry.m_next = m_head;
+    if (m_head != npos) {
+        m_entries[m_head].m_prev = index;
+    } else {
+        m_tail = index;
+    }
+    m_head = index;
+}
+
+template <typename K, typename V>
+size_t lru_cache<K,V>::weight(const lru_cache_entry& entry) const {
+    if (m_maxBytes == 0) {
+        return 0;
+    }
+    return cache_weight(entry.m_key) + (entry.m_value ? cache_weight(*entry.m_value) : 0);
+}
+
+//remove the entry held in the given probe slot and return its value
+template <typename K, typename V>
+std::unique_ptr<V> lru_cache<K,V>::remove(size_t slot) {
+    uint32_t index = m_slots[slot];
+    unlink(index);
+    m_bytes -= m_entries[index].m_weight;
+    std::unique_ptr<V> value = std::move(m_entries[index].m_value);
+
+    //backward-shift deletion keeps every probe sequence unbroken without tombstones
+    size_t hole = slot;
+    size_t current = next_slot(slot);
+    while (m_slots[current] != npos) {
+        size_t home = home_slot(m_entries[m_slots[current]].m_key);
+        bool movable = hole <= current ? (home <= hole || home > current) : (home <= hole && home > current);
+        if (movable) {
+            m_slots[hole] = m_slots[current];
+            hole = current;
+        }
+        current = next_slot(current);
+    }
+    m_slots[hole] = npos;
+
+    //fill the hole in the dense storage with the last entry
+    uint32_t last = static_cast<uint32_t>(m_entries.size() - 1);
+    if (index != last) {
+        bool found = false;
+        size_t lastSlot = probe(m_entries[last].m_key, found);
+        m_slots[lastSlot] = index;
+
+        lru_cache_entry& moved = m_entries[last];
+        if (moved.m_prev != npos) {
+            m_entries[moved.m_prev].m_next = index;
+        } else {
+            m_head = index;
+        }
+        if (moved.m_next != npos) {
+            m_entries[moved.m_next].m_prev = index;
+        } else {
+            m_tail = index;
+        }
+        m_entries[index] = std::move(moved);
+    }
+    m_entries.pop_back();
+    return value;
+}
+
+template <typename K, typename V>
+void lru_cache<K,V>::insert(const K& key, std::unique_ptr<V> value) {
+    if (!try_insert(key, std::move(value))) {
+        throw duplicate_key();
+    }
+}
+
+template <typename K, typename V>
+const std::unique_ptr<V>& lru_cache<K,V>::peek(const K& key) {
+    const std::unique_ptr<V>* value = find(key);
+    if (value == nullptr) {
+        throw nonexistent_key();
+    }
+    return *value;
+}
+
+template <typename K, typename V>
+std::unique_ptr<V> lru_cache<K,V>::extract(const K& key) {
+    std::optional<std::unique_ptr<V>> value = try_extract(key);
+    if (!value) {
+        throw nonexistent_key();
+    }
+    return std::move(*value);
+}
+
+template <typename K, typename V>
+bool lru_cache<K,V>::try_insert(const K& key, std::unique_ptr<V> value) {
+    bool found = false;
+    probe(key, found);
+    if (found) {
+        return false;
+    }
+
+    lru_cache_entry entry;
+    entry.m_key = key;
+    entry.m_value = std::move(value);
+    entry.m_weight = weight(entry);
+    size_t entryWeight = entry.m_weight;
+    //evicting could never make room for it, so it would only flush the cache and break the budget
+    if (m_maxBytes != 0 && entryWeight > m_maxBytes) {
+        throw std::length_error("entry is larger than the lru_cache byte budget");
+    }
+
+    //evict from the cold end until the new entry fits
+    while (m_tail != npos && (m_entries.size() == m_maxEntries ||
+                              (m_maxBytes != 0 && m_bytes + entryWeight > m_maxBytes))) {
+        size_t slot = probe(m_entries[m_tail].m_key, found);
+        remove(slot);
+        m_evictions++;
+    }
+
+    size_t slot = probe(key, found);
+    uint32_t index = static_cast<uint32_t>(m_entries.size());
+    m_entries.push_back(std::move(entry));
+    m_slots[slot] = index;
+    push_front(index);
+    m_bytes += entryWeight;
+    return true;
+}
+
+template <typename K, typename V>
+const std::unique_ptr<V>* lru_cache<K,V>::find(const K& key) {
+    bool found = false;
+    size_t slot = probe(key, found);
+    if (!found) {
+        m_misses++;
+        return nullptr;
+    }
+
+    m_hits++;
+    uint32_t index = m_slots[slot];
+    if (index != m_head) {
+        unlink(index);
+        push_front(index);
+    }
+    return &m_entries[index].m_value;
+}
+
+template <typename K, typename V>
+std::optional<std::unique_ptr<V>> lru_cache<K,V>::try_extract(const K& key) {
+    bool found = false;
+    size_t slot = probe(key, found);
+    if (!found) {
+        return std::nullopt;
+    }
+    return remove(slot);
+}
+
+template <typename K, typename V>
+const K& lru_cache<K,V>::lru_key() const {
+    if (m_tail == npos) {
+        throw nonexistent_key();
+    }
+    return m_entries[m_tail].m_key;
+}
+
+template <typename K, typename V>
+template <typename Fn>
+void lru_cache<K,V>::for_each(Fn fn) const {
+    for (uint32_t index = m_head; index != npos; index = m_entries[index].m_next) {
+        fn(m_entries[index].m_key, m_entries[index].m_value);
+    }
+}
+
+template <typename K, typename V>
+size_t lru_cache<K,V>::size() const {
+    return m_entries.size();
+}
+
+template <typename K, typename V>
+size_t lru_cache<K,V>::capacity() const {
+    return m_maxEntries;
+}
+
+template <typename K, typename V>
+size_t lru_cache<K,V>::bytes() const {
+    return m_bytes;
+}
+
+template <typename K, typename V>
+bool lru_cache<K,V>::empty() const {
+    return m_entries.empty();
+}
+
+template <typename K, typename V>
+size_t lru_cache<K,V>::hits() const {
+    return m_hits;
+}
+
+template <typename K, typename V>
+size_t lru_cache<K,V>::misses() const {
+    return m_misses;
+}
+
+template <typename K, typename V>
+size_t lru_cache<K,V>::evictions() const {
+    return m_evictions;
+}
+
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <algorithm>
+namespace cs251 {
+
+// Slab allocator for fixed-type tree nodes
+// Nodes are carved out of slabs that double in size up to max_slab_size, and released nodes are
+// reset and kept on a free list for reuse; all memory goes back at once when the pool is destroyed
+template <typename T>
+class node_pool {
+public:
+	// Nodes in the first slab and the cap on slab growth
+	static constexpr size_t min_slab_size = 4;
+	static constexpr size_t max_slab_size = 4096;
+
+	node_pool() = default;
+	node_pool(const node_pool&) = delete;
+	node_pool& operator=(const node_pool&) = delete;
+	node_pool(node_pool&& other) noexcept;
+	node_pool& operator=(node_pool&& other) noexcept;
+
+	// Return a default-constructed node
+	T* allocate();
+	// Reset the node to its default state and make it available again
+	void release(T* node);
+	// Take over every slab of other, which must no longer be used to allocate the nodes it hands out
+	void absorb(node_pool& other);
+
+	// Return the number of slabs allocated
+	size_t slab_count() const;
+
+private:
+	struct slab {
+		std::unique_ptr<T[]> m_nodes;
+		size_t m_size;
+	};
+
+	std::vector<slab> m_slabs {};
+	std::vector<T*> m_free {};
+	// Nodes handed out from the newest slab
+	size_t m_used = 0;
+};
+
+template <typename T>
+node_pool<T>::node_pool(node_pool&& other) noexcept
+    : m_slabs(std::move(other.m_slabs)), m_free(std::move(other.m_free)), m_used(other.m_used) {
+    other.m_slabs.clear();
+    other.m_free.clear();
+    other.m_used = 0;
+}
+
+template <typename T>
+node_pool<T>& node_pool<T>::operator=(node_pool&& other) noexcept {
+    if (this != &other) {
+        m_slabs = std::move(other.m_slabs);
+        m_free = std::move(other.m_free);
+        m_used = other.m_used;
+        other.m_slabs.clear();
+        other.m_free.clear();
+        other.m_used = 0;
+    }
+    return *this;
+}
+
+template <typename T>
+T* node_pool<T>::allocate() {
+    if (!m_free.empty()) {
+        T* node = m_free.back();
+        m_free.pop_back();
+        return node;
+    }
+
+    if (m_slabs.empty() || m_used == m_slabs.back().m_size) {
+        size_t size = m_slabs.empty() ? min_slab_size : std::min(m_slabs.back().m_size * 2, max_slab_size);
+        m_slabs.push_back(slab{std::make_unique<T[]>(size), size});
+        m_used = 0;
+    }
+    return &m_slabs.back().m_nodes[m_used++];
+}
+
+template <typename T>
+void node_pool<T>::release(T* node) {
+    *node = T();
+    m_free.push_back(node);
+}
+
+template <typename T>
+void node_pool<T>::absorb(node_pool& other) {
+    if (this == &other || other.m_slabs.empty()) {
+        return;
+    }
+
+    //keep the partially used newest slab last, so allocation continues from it
+    size_t used = m_slabs.empty() ? 0 : m_used;
+    std::vector<slab> slabs = std::move(other.m_slabs);
+    if (!m_slabs.empty()) {
+        //the unused tail of our newest slab becomes free nodes
+        slab& newest = m_slabs.back();
+        for (size_t i = used; i < newest.m_size; i++) {
+            m_free.push_back(&newest.m_nodes[i]);
+        }
+    }
+    m_slabs.insert(m_slabs.end(), std::make_move_iterator(slabs.begin()), std::make_move_iterator(slabs.end()));
+    m_free.insert(m_free.end(), other.m_free.begin(), other.m_free.end());
+    m_used = other.m_used;
+
+    other.m_slabs.clear();
+    other.m_free.clear();
+    other.m_used = 0;
+}
+
+template <typename T>
+size_t node_pool<T>::slab_count() const {
+    return m_slabs.size();
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <string_view>
+namespace cs251 {
+
+// Prefix scans for splay_tree::for_each_with_prefix
+// A key type opts in by naming the text that prefixes are matched against, which must lead its
+// order, so that the keys whose text starts with a prefix form one run in key order
+//   lowest(prefix)                            the smallest key whose text could start with prefix
+//   matches(key, prefix)                      whether the text of key starts with prefix
+
+// The default for keys without text - prefix scans are unavailable
+template <typename K>
+struct prefix_scan {
+	static constexpr bool enabled = false;
+};
+
+template <>
+struct prefix_scan<std::string> {
+	static constexpr bool enabled = true;
+	static std::string lowest(const std::string_view prefix) { return std::string(prefix); }
+	static bool matches(const std::string& key, const std::string_view prefix) { return key.starts_with(prefix); }
+};
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <istream>
+#include <ostream>
+#include <string>
+#include <cstdint>
+#include <type_traits>
+#include <algorithm>
+namespace cs251 {
+
+// Binary serialization of keys and values for save and load
+//   write(out, item)                          write item to out
+//   read(in)                                  read an item back from in
+// read leaves in failed on a short read; the caller checks the stream
+// Items are written in the native byte order, for restarts on the same kind of machine
+
+// Trivially copyable types are written as their bytes
+template <typename T>
+struct serializer {
+	static_assert(std::is_trivially_copyable_v<T>, "specialize cs251::serializer for this type");
+
+	static void write(std::ostream& out, const T& item) {
+		out.write(reinterpret_cast<const char*>(&item), sizeof(T));
+	}
+	static T read(std::istream& in) {
+		T item {};
+		in.read(reinterpret_cast<char*>(&item), sizeof(T));
+		return item;
+	}
+};
+
+// Strings are written as their length followed by their characters
+template <>
+struct serializer<std::string> {
+	static void write(std::ostream& out, const std::string& item) {
+		serializer<uint64_t>::write(out, item.size());
+		out.write(item.data(), static_cast<std::streamsize>(item.size()));
+	}
+	static std::string read(std::istream& in) {
+		uint64_t size = serializer<uint64_t>::read(in);
+		std::string item;
+		//grow with the data actually read, so a corrupt length cannot allocate without bound
+		char buffer[4096];
+		while (in && size > 0) {
+			uint64_t chunk = std::min<uint64_t>(size, sizeof(buffer));
+			in.read(buffer, static_cast<std::streamsize>(chunk));
+			item.append(buffer, static_cast<size_t>(in.gcount()));
+			size -= chunk;
+		}
+		return item;
+	}
+};
+
+}
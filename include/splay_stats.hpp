@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <ostream>
+#include <iomanip>
+namespace cs251 {
+
+// Whether splay trees count their splay steps, which is off unless built with CS251_SPLAY_STATS
+#ifdef CS251_SPLAY_STATS
+inline constexpr bool splay_stats_enabled = true;
+#else
+inline constexpr bool splay_stats_enabled = false;
+#endif
+
+// Work done by a splay tree's splays since it was created or its counters were reset
+struct splay_counters {
+	// Calls to find, peek, insert and extract (and their non-throwing forms), hits or not
+	uint64_t m_operations = 0;
+	// Splays, and the total depth of the nodes they brought up
+	uint64_t m_splays = 0;
+	uint64_t m_pathLength = 0;
+	// Splay steps by kind; a zig is one rotation, a zig-zig or zig-zag two
+	uint64_t m_zigs = 0;
+	uint64_t m_zigZigs = 0;
+	uint64_t m_zigZags = 0;
+
+	uint64_t rotations() const { return m_zigs + 2 * (m_zigZigs + m_zigZags); }
+	splay_counters& operator+=(const splay_counters& other) {
+		m_operations += other.m_operations;
+		m_splays += other.m_splays;
+		m_pathLength += other.m_pathLength;
+		m_zigs += other.m_zigs;
+		m_zigZigs += other.m_zigZigs;
+		m_zigZags += other.m_zigZags;
+		return *this;
+	}
+};
+
+// The shape of a splay tree, and its counters (all zero unless splay_stats_enabled)
+struct splay_stats {
+	size_t m_nodes = 0;
+	// Levels on the longest path from the root
+	size_t m_height = 0;
+	// m_depths[d] is the number of nodes at depth d, the root being at depth 0
+	std::vector<size_t> m_depths {};
+	// Slabs held by the node pool the tree allocates from, which stops growing while released
+	// nodes are being reused
+	size_t m_slabs = 0;
+	// Entries kept outside any tree, in the flat buckets of an adaptive_hash_map
+	size_t m_flat = 0;
+	splay_counters m_counters {};
+
+	double average_depth() const {
+		size_t total = 0;
+		for (size_t depth = 0; depth < m_depths.size(); depth++) {
+			total += depth * m_depths[depth];
+		}
+		return m_nodes == 0 ? 0.0 : static_cast<double>(total) / m_nodes;
+	}
+	double rotations_per_operation() const {
+		return m_counters.m_operations == 0 ? 0.0 : static_cast<double>(m_counters.rotations()) / m_counters.m_operations;
+	}
+	// Combine the stats of several trees, such as the buckets of a hash table
+	splay_stats& operator+=(const splay_stats& other) {
+		m_nodes += other.m_nodes;
+		m_height = std::max(m_height, other.m_height);
+		m_depths.resize(std::max(m_depths.size(), other.m_depths.size()));
+		for (size_t depth = 0; depth < other.m_depths.size(); depth++) {
+			m_depths[depth] += other.m_depths[depth];
+		}
+		//trees combined this way share one pool, so its slabs are counted once
+		m_slabs = std::max(m_slabs, other.m_slabs);
+		m_flat += other.m_flat;
+		m_counters += other.m_counters;
+		return *this;
+	}
+};
+
+// Print the stats in the drivers' format: the shape, the flat entries if there are any, then the
+// counters or a note that they are off
+inline void print_stats(std::ostream& out, const splay_stats& stats) {
+	std::ios_base::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << "nodes " << stats.m_nodes << ", height " << stats.m_height << ", average depth "
+		<< std::fixed << std::setprecision(2) << stats.average_depth() << std::endl;
+	out << "depths:";
+	for (size_t count : stats.m_depths)
+		out << " " << count;
+	out << std::endl;
+	out << "pool slabs " << stats.m_slabs << std::endl;
+	if (stats.m_flat > 0)
+		out << "flat entries " << stats.m_flat << std::endl;
+	if (splay_stats_enabled) {
+		const splay_counters& counters = stats.m_counters;
+		out << "operations " << counters.m_operations << ", splays " << counters.m_splays
+			<< ", path length " << counters.m_pathLength << std::endl;
+		out << "rotations " << counters.rotations() << " (" << stats.rotations_per_operation()
+			<< " per operation): zig " << counters.m_zigs << ", zig-zig " << counters.m_zigZigs
+			<< ", zig-zag " << counters.m_zigZags << std::endl;
+	} else {
+		out << "splay counters disabled (build with CS251_SPLAY_STATS)" << std::endl;
+	}
+	out.flags(flags);
+	out.precision(precision);
+}
+
+}
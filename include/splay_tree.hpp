@@ -2,19 +2,124 @@
 #include <sstream>
 #include <exception>
 #include <memory>
+#include <optional>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <cstddef>
+#include <type_traits>
+#include <stdexcept>
+#include <thread>
+#include <ranges>
+#include <bit>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "common.hpp"
+#include "node_pool.hpp"
+#include "augment.hpp"
+#include "key_prefix.hpp"
+#include "key_compare.hpp"
+#include "prefix_scan.hpp"
+#include "serializer.hpp"
+#include "splay_stats.hpp"
 namespace cs251 {
 
-// Custom exception classes
-class duplicate_key : public std::runtime_error {
-	public: duplicate_key() : std::runtime_error("Duplicate key!") {} };
-class nonexistent_key : public std::runtime_error {
-	public: nonexistent_key() : std::runtime_error("Key does not exist!") {} };
-class empty_tree : public std::runtime_error {
-	public: empty_tree() : std::runtime_error("Tree is empty!") {} };
+template <typename K, typename V> class adaptive_hash_map;
 
-template <typename K, typename V>
+// How splay_tree restructures the tree when find or peek hits a key
+// Skipping or shortening splays saves writes on read-mostly workloads without much locality
+struct splay_policy {
+	enum class mode {
+		// Splay the node to the root on every access
+		full,
+		// Splay the node only halfway, to the depth of its ancestor at half its depth
+		semi,
+		// Splay on one access in m_period
+		every_kth,
+		// Splay each access with probability m_probability
+		probability,
+		// Splay only when the node is deeper than m_depthFactor * log2(size)
+		depth_threshold
+	};
+
+	mode m_mode = mode::full;
+	uint32_t m_period = 1;
+	float m_probability = 1.0f;
+	float m_depthFactor = 2.0f;
+
+	static splay_policy full() { return {}; }
+	static splay_policy semi() { return {mode::semi}; }
+	static splay_policy every_kth(uint32_t period) { return {mode::every_kth, period}; }
+	static splay_policy with_probability(float probability) { return {mode::probability, 1, probability}; }
+	static splay_policy depth_threshold(float depthFactor) { return {mode::depth_threshold, 1, 1.0f, depthFactor}; }
+};
+
+template <typename K, typename V, typename Augment = no_augment, typename Compare = key_compare<K>>
 class splay_tree {
 public:
+	// Keys are ordered by Compare (see key_compare.hpp), which defaults to their natural order
+	// Cached key prefixes follow the natural order, so a tree with a custom Compare goes without them
+	static constexpr bool natural_order = std::is_same_v<Compare, key_compare<K>>;
+	using prefix_traits = std::conditional_t<natural_order, key_prefix<K>, no_key_prefix<K>>;
+
+	// A node of the tree, allocated from its node pool
+	struct tree_node {
+		// Pointer to the left child
+		tree_node* m_left = nullptr;
+		// Pointer to the right child
+		tree_node* m_right = nullptr;
+		// Order-preserving prefix of the key, read by descents before the key itself
+		// (takes no space for keys without a key_prefix, or under a custom Compare)
+		[[no_unique_address]] typename prefix_traits::value_type m_prefix {};
+
+		// The key of this element
+		K m_key {};
+		// Hits counted while access tracking is on (fits the padding after small keys)
+		uint32_t m_accesses = 0;
+		// Pointer to the value of this element
+		std::unique_ptr<V> m_value {};
+		// Aggregate of this subtree kept by Augment (takes no space with no_augment)
+		[[no_unique_address]] typename Augment::value_type m_aggregate {};
+	};
+
+	// Forward iterator over the nodes in key order
+	// Iterating never splays, but any other operation on the tree (including find and peek,
+	// which splay) invalidates every iterator
+	class const_iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = tree_node;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const tree_node*;
+		using reference = const tree_node&;
+
+		const_iterator() = default;
+
+		reference operator*() const;
+		pointer operator->() const;
+		// Advance to the next key in amortized O(1)
+		const_iterator& operator++();
+		const_iterator operator++(int);
+		bool operator==(const const_iterator& other) const;
+
+	private:
+		friend class splay_tree;
+		// Push node and its chain of left children
+		void push_left(const tree_node* node);
+
+		// The current node on top, and below it every ancestor still to be visited
+		std::vector<const tree_node*> m_path {};
+	};
+
+	// The node of the original interface, linked by shared pointers (see get_root)
 	struct splay_tree_node {
 		// Pointer to the left child
 		std::shared_ptr<splay_tree_node> m_left {};
@@ -30,13 +135,26 @@ public:
 	};
 
 	// Return a pointer to the root of the tree
+	const tree_node* root() const;
+	// Return a copy of the tree made of splay_tree_node, for callers of the original interface
+	// Copies every key and value in O(n) without splaying; walk root() to read the tree in place
 	std::shared_ptr<splay_tree_node> get_root() const;
 
 	// Default constructor - create an empty splay tree
 	splay_tree();
+	// Nodes belong to the tree's pool, so trees can be moved but not copied
+	splay_tree(const splay_tree&) = delete;
+	splay_tree& operator=(const splay_tree&) = delete;
+	splay_tree(splay_tree&& other) noexcept;
+	splay_tree& operator=(splay_tree&& other) noexcept;
+	// Destructor - remove every element as clear does, so a tree split off another (which shares
+	// its pool) hands its nodes back for reuse
+	~splay_tree();
 
 	// Insert the key/value pair into the tree, if the key doesn't already exist
 	// Throw duplicate_key if the key already exists
+	// A key past the root's empty side (as each key of an ascending run is) is linked in at the root
+	// in O(1), exactly as splaying it would
 	void insert(const K& key, std::unique_ptr<V> value);
 	// Return a const reference to the value associated with the given key
 	// Throw nonexistent_key if the key is not in the splay tree
@@ -45,6 +163,118 @@ public:
 	// Throw nonexistent_key if the key is not in the splay tree
 	std::unique_ptr<V> extract(const K& key);
 
+	// Non-throwing counterparts of insert/peek/extract for miss-heavy callers
+	// Insert the key/value pair and return true, or return false if the key already exists
+	bool try_insert(const K& key, std::unique_ptr<V> value);
+	// Return a pointer to the value associated with the given key and splay the node,
+	// or return nullptr (without splaying) if the key is not in the splay tree
+	const std::unique_ptr<V>* find(const K& key);
+	// Remove and return the value associated with the given key, or std::nullopt if it is missing
+	std::optional<std::unique_ptr<V>> try_extract(const K& key);
+
+	// Look up a batch of keys (any range of K) without splaying, and return a pointer to each value in
+	// the order of keys, or nullptr for a missing key
+	// The batch is walked in key order, each search resuming from where the previous one left the path,
+	// so a key costs O(log gap) amortized in the distance to the previous one instead of O(log n)
+	template <typename Range> std::vector<const std::unique_ptr<V>*> peek_many(const Range& keys) const;
+
+	// Move every entry of other into this tree in O(n + m), relinking the existing nodes
+	// into a balanced tree instead of inserting them one by one; conflicts are resolved by policy
+	// If the keys of other all fall between two neighbouring keys of this tree (or outside its
+	// range), other is instead joined in with split/join in O(log n) amortized
+	// Return the number of entries moved into this tree
+	size_t merge(splay_tree& other, merge_policy policy = merge_policy::keep_existing);
+	size_t merge(splay_tree&& other, merge_policy policy = merge_policy::keep_existing);
+
+	// Split and join - whole key ranges move between trees by relinking O(log n) nodes
+	// The trees they return allocate from this tree's node pool
+	// Without a counting augmentation, sizing the two parts also costs O(min(k, n - k))
+	// Remove the entries with keys not less than key and return them as a new tree
+	splay_tree split(const K& key);
+	// Return the tree holding the entries of left and right
+	// Throw std::invalid_argument unless every key of left is less than every key of right
+	static splay_tree join(splay_tree&& left, splay_tree&& right);
+	// Remove the entries with lo <= key <= hi and return them as a new tree
+	splay_tree extract_range(const K& lo, const K& hi);
+
+	// Bulk loading - build a balanced tree in O(n) without splaying
+	// range holds pair-like (key, value) elements, and the values are moved out of it
+	// Build from elements sorted by strictly increasing key
+	// Throw duplicate_key if a key repeats, or std::invalid_argument if the keys are out of order
+	template <typename Range> static splay_tree build_sorted(Range&& range);
+	// Build from elements in any order, sorting them first in O(n log n), on every core if parallel
+	// Throw duplicate_key if a key repeats
+	template <typename Range> static splay_tree build(Range&& range, bool parallel = false);
+
+	// Return an iterator to the smallest key, without splaying
+	const_iterator begin() const;
+	// Return the past-the-end iterator
+	const_iterator end() const;
+	// Return an iterator to the first key not less than key, and splay that node
+	// Return end() (without splaying) if there is no such key
+	const_iterator lower_bound(const K& key);
+	// Return an iterator to the first key greater than key, and splay that node
+	// Return end() (without splaying) if there is no such key
+	const_iterator upper_bound(const K& key);
+	// Call fn(key, value) for every entry with lo <= key <= hi in key order
+	// Only the first entry of the range is splayed, the rest are streamed in amortized O(1) each
+	template <typename Fn> void for_each_in_range(const K& lo, const K& hi, Fn fn);
+	// Call fn(key, value) for every entry whose key text starts with prefix, in key order - the whole
+	// key for std::string, the last name for name (see prefix_scan.hpp)
+	// The scan starts at the first possible match, which is splayed, and stops at the first key past
+	// the run, so it costs O(log n) amortized plus O(1) per match
+	template <typename Fn> void for_each_with_prefix(std::string_view prefix, Fn fn) requires (prefix_scan<K>::enabled && natural_order);
+
+	// Order statistics and range aggregates, available with an augmentation (see augment.hpp)
+	// Each costs one descent and splays the deepest node it visited, so it is O(log n) amortized
+	// Return the number of keys less than key
+	size_t rank(const K& key) requires requires (typename Augment::value_type a) { Augment::count(a); };
+	// Return an iterator to the key with i smaller keys, and splay that node
+	// Return end() (without splaying) if i is not less than size()
+	const_iterator select(size_t i) requires requires (typename Augment::value_type a) { Augment::count(a); };
+	// Return the aggregate of the entries with lo <= key <= hi
+	typename Augment::value_type aggregate(const K& lo, const K& hi);
+	// Return the sum of the values with lo <= key <= hi
+	auto range_sum(const K& lo, const K& hi) requires requires (typename Augment::value_type a) { Augment::sum(a); };
+
+	// Set how find and peek restructure the tree (splay_policy::full by default)
+	// Every other operation still splays fully
+	void set_splay_policy(const splay_policy& policy);
+	// Return the current splay policy
+	const splay_policy& get_splay_policy() const;
+
+	// Weighted rebuilds - for stationary skewed workloads, an occasional O(n) rebuild into a static
+	// shape fitted to the observed frequencies can beat continuous rotations; pair them with a
+	// splay policy that rarely splays so the shape survives between rebuilds
+	// Start or stop counting find and peek hits per node
+	void set_access_tracking(bool enabled);
+	// Rebuild the tree in O(n), rooting every subtree at the weighted median of its nodes' hit counts
+	// (plus one each), which keeps the expected depth within 2 of the entropy bound; the counts are then
+	// halved so older accesses fade
+	void rebuild_weighted();
+	// Turn access tracking on and, after every max(interval, size()) hits, rebuild if the average
+	// depth of those hits exceeds slack times the bound; interval 0 stops automatic rebuilds
+	void set_auto_rebuild(size_t interval, double slack = 1.5);
+
+	// Warm restarts - save records the exact shape of the tree, so every key comes back at the depth
+	// splaying had left it, and load rebuilds that shape in O(n) without comparing or rotating
+	// Keys and values go through cs251::serializer (see serializer.hpp); null values are kept
+	// Write the tree to the file at path
+	// Throw serialization_error if the file cannot be written
+	void save(const std::string& path) const;
+	void save(std::ostream& out) const;
+	// Replace the entries of the tree with those saved in the file at path, keeping the splay policy
+	// and access tracking settings (the hit counts start over)
+	// Throw serialization_error if the file cannot be read or does not hold a saved tree, leaving
+	// the tree unchanged
+	void load(const std::string& path);
+	void load(std::istream& in);
+
+	// Return the shape of the tree, measured in O(n) without splaying, and its splay counters
+	splay_stats stats() const;
+	// Zero the splay counters
+	void reset_stats();
+
 	// Return the minimum key in the splay tree, and splay the node
 	// Throw empty_tree if the tree is empty
 	K minimum_key();
@@ -52,6 +282,29 @@ public:
 	// Throw empty_tree if the tree is empty
 	K maximum_key();
 
+	// Double-ended priority queue access - the tree keeps pointers to its smallest and largest nodes
+	// Return the minimum key in O(1), without splaying, unless the minimum was extracted since
+	// it was last found; the new one is then splayed to the root
+	// Throw empty_tree if the tree is empty
+	const K& first_key();
+	// Return the maximum key in O(1), without splaying, unless the maximum was extracted since
+	// it was last found; the new one is then splayed to the root
+	// Throw empty_tree if the tree is empty
+	const K& last_key();
+	// Remove and return the entry with the minimum key, splaying it out as extract does
+	// Throw empty_tree if the tree is empty
+	std::pair<K, std::unique_ptr<V>> extract_min();
+	// Remove and return the entry with the maximum key, splaying it out as extract does
+	// Throw empty_tree if the tree is empty
+	std::pair<K, std::unique_ptr<V>> extract_max();
+	// Remove and return the entries with the k smallest keys (all of them if k >= size()) in key order
+	// They are cut off with a single split, in O(k) plus O(log n) amortized
+	std::vector<std::pair<K, std::unique_ptr<V>>> pop_k_smallest(size_t k);
+
+	// Remove every element; a tree that does not share its node pool frees it a slab at a time
+	// instead of node by node, and no teardown path recurses, so any tree depth is safe
+	void clear();
+
 	// Return the current number of elements in the splay tree
 	bool empty() const;
 	// Return whether the splay tree is currently empty
@@ -59,330 +312,1709 @@ public:
 
 private:
 	// Pointer to the root node of the splay tree
-	std::shared_ptr<splay_tree_node> m_root {};
+	tree_node* m_root = nullptr;
+	// Slab allocator that owns every node of the tree, created on first use
+	// The buckets of an adaptive_hash_map share a single pool
+	std::shared_ptr<node_pool<tree_node>> m_pool {};
+	// The nodes with the smallest and largest keys, nullptr while the tree is empty or after that
+	// extreme was extracted, until first_key or last_key splays the new one to the root
+	tree_node* m_min = nullptr;
+	tree_node* m_max = nullptr;
 
 	// TODO: Add any additional methods or variables here
-    void rightRotation(std::shared_ptr<splay_tree_node>& current);
-    void leftRotation(std::shared_ptr<splay_tree_node>& current);
-    void splay(std::shared_ptr<splay_tree_node>& current);
-    void zig(std::shared_ptr<splay_tree_node>& current);
-    void zigZig(std::shared_ptr<splay_tree_node>& current);
-    void zigZag(std::shared_ptr<splay_tree_node>& current);
+    tree_node* probe(const K& key, size_t& depth) const;
+    void splay(const K& key, size_t depth, tree_node* inserted = nullptr);
+    void splay_subtree(tree_node*& top, const K& key, size_t depth, tree_node* inserted);
+    bool should_splay(size_t depth);
+    void record_access(tree_node* node, size_t depth);
+    double entropy_bound() const;
+    tree_node* find_node(const K& key) const;
+    static tree_node* leftmost(tree_node* node);
+    static tree_node* rightmost(tree_node* node);
+    tree_node* find_bound(const K& key, bool inclusive, size_t& depth) const;
+    const_iterator splay_bound(tree_node* bound, size_t depth);
+    node_pool<tree_node>& pool();
+
+    // Key comparison through the cached prefixes
+    using prefix_type = typename prefix_traits::value_type;
+    static void set_key(tree_node* node, K key);
+    static int compare(const K& key, const prefix_type& prefix, const tree_node* node);
+    static bool less(const K& a, const K& b);
+
+    // Subtree aggregate upkeep, compiled out with no_augment
+    static constexpr bool augmented = !std::is_same_v<Augment, no_augment>;
+    static constexpr bool counted = requires (typename Augment::value_type a) { Augment::count(a); };
+    static typename Augment::value_type aggregate_of(const tree_node* node);
+    static void pull(tree_node* node);
+    static void pull_spine(tree_node* top, size_t count, tree_node* tree_node::* link);
+
+    // Bulk node transfer used by merge and adaptive_hash_map
+    friend class adaptive_hash_map<K,V>;
+    explicit splay_tree(std::shared_ptr<node_pool<tree_node>> pool);
+    using node_list = std::vector<tree_node*>;
+    node_list detach_nodes();
+    void attach_sorted(node_list& nodes);
+    tree_node* build_balanced(node_list& nodes, size_t begin, size_t end);
+    tree_node* adopt(tree_node* node, node_pool<tree_node>& source);
+    size_t merge_sorted(node_list& mine, node_list& theirs, node_pool<tree_node>& source,
+                        merge_policy policy, node_list& merged, node_list& leftovers);
+    void share_pool(splay_tree& other);
+    void forget_nodes();
+    splay_tree split_off(const K& key, bool inclusive);
+    void append(splay_tree& right);
+    // Elements below which a parallel sort does not split the work any further
+    static constexpr size_t parallel_grain = 1 << 14;
+    using entry_list = std::vector<std::pair<K, std::unique_ptr<V>>>;
+    static void sort_entries(entry_list& entries, bool parallel);
+    static size_t count_first(const tree_node* first, const tree_node* second, size_t total);
+
+    // Serialized form: the node count, then each node in preorder as a shape byte (shape_left,
+    // shape_right, shape_value) followed by its key and, if present, its value
+    static constexpr char file_magic[8] = {'C', 'S', '2', '5', '1', 'S', 'P', 'T'};
+    static constexpr uint32_t file_version = 1;
+    static constexpr uint8_t shape_left = 1;
+    static constexpr uint8_t shape_right = 2;
+    static constexpr uint8_t shape_value = 4;
+    void write_nodes(std::ostream& out) const;
+    void read_nodes(std::istream& in);
 
     size_t m_numElements;
+    splay_policy m_policy {};
+    // Accesses seen by every_kth, or the xorshift state of probability
+    uint32_t m_policyState = 0;
+
+    // Access tracking state, absent while tracking is off
+    struct access_stats {
+        size_t m_interval = 0;
+        double m_slack = 1.5;
+        size_t m_hits = 0;
+        size_t m_depthSum = 0;
+    };
+    std::unique_ptr<access_stats> m_stats {};
+
+    // Splay counters, which along with their upkeep compile to nothing unless splay_stats_enabled
+    void count_operation();
+    void count_splay(size_t depth, size_t zigZigs);
+#ifdef CS251_SPLAY_STATS
+    splay_counters m_counters {};
+#endif
 };
 
-template <typename K, typename V>
-std::shared_ptr<typename splay_tree<K,V>::splay_tree_node> splay_tree<K,V>::get_root() const {
+template <typename K, typename V, typename Augment, typename Compare>
+const typename splay_tree<K,V,Augment,Compare>::tree_node* splay_tree<K,V,Augment,Compare>::root() const {
 	return m_root;
 }
 
-template <typename K, typename V>
-void splay_tree<K,V>::rightRotation(std::shared_ptr<splay_tree_node>& nodeY) {
-    std::shared_ptr<splay_tree_node> nodeX = nodeY->m_left;
-    if (nodeX == nullptr) {
-        return;
+template <typename K, typename V, typename Augment, typename Compare>
+std::shared_ptr<typename splay_tree<K,V,Augment,Compare>::splay_tree_node> splay_tree<K,V,Augment,Compare>::get_root() const {
+    if (m_root == nullptr) {
+        return nullptr;
     }
-    nodeY->m_left = nodeX->m_right;
-    if (nodeX->m_right != nullptr) {
-        (nodeX->m_right)->m_parent = nodeY;
+    //copy breadth first from a queue rather than recursing down the tree
+    auto copy = [](const tree_node* node, const std::shared_ptr<splay_tree_node>& parent) {
+        auto result = std::make_shared<splay_tree_node>();
+        result->m_key = node->m_key;
+        if (node->m_value) {
+            result->m_value = std::make_unique<V>(*node->m_value);
+        }
+        result->m_parent = parent;
+        return result;
+    };
+    std::shared_ptr<splay_tree_node> result = copy(m_root, nullptr);
+    std::vector<std::pair<const tree_node*, std::shared_ptr<splay_tree_node>>> pending {{m_root, result}};
+    for (size_t i = 0; i < pending.size(); i++) {
+        const tree_node* node = pending[i].first;
+        std::shared_ptr<splay_tree_node> target = pending[i].second;
+        if (node->m_left) {
+            target->m_left = copy(node->m_left, target);
+            pending.emplace_back(node->m_left, target->m_left);
+        }
+        if (node->m_right) {
+            target->m_right = copy(node->m_right, target);
+            pending.emplace_back(node->m_right, target->m_right);
+        }
     }
+    return result;
+}
 
-    nodeX->m_parent = nodeY->m_parent;
-    std::shared_ptr<splay_tree_node> parentY = nodeY->m_parent.lock();
-    if (parentY != nullptr) {
-        if (parentY->m_left == nodeY) {
-            parentY->m_left = nodeX;
+//return the node holding key, or nullptr if it is missing
+//depth is set to the depth of that node, or of the empty link where key would be inserted
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::tree_node* splay_tree<K,V,Augment,Compare>::probe(const K& key, size_t& depth) const {
+    tree_node* current = m_root;
+    prefix_type prefix = prefix_traits::of(key);
+    depth = 0;
+
+    while (current != nullptr) {
+        int order = compare(key, prefix, current);
+        if (order == 0) {
+            return current;
+        }
+
+        if (order < 0) {
+            current = current->m_left;
         } else {
-            parentY->m_right = nodeX;
+            current = current->m_right;
         }
-    } else {
-        m_root = nodeX;
+        depth++;
     }
-    nodeX->m_right = nodeY;
-    nodeY->m_parent = nodeX;
+    return nullptr;
 }
 
-template <typename K, typename V>
-void splay_tree<K,V>::leftRotation(std::shared_ptr<splay_tree_node>& nodeX) {
-    std::shared_ptr<splay_tree_node> nodeY = nodeX->m_right;
-    if (nodeY == nullptr) {
-        return;
+//set the key of node along with its cached prefix
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::set_key(tree_node* node, K key) {
+    node->m_prefix = prefix_traits::of(key);
+    node->m_key = std::move(key);
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+bool splay_tree<K,V,Augment,Compare>::less(const K& a, const K& b) {
+    return Compare{}(a, b) < 0;
+}
+
+//return a negative number, zero or a positive number as key (whose prefix is given) orders
+//before, equal to or after the key of node; differing prefixes settle it without reading the key
+template <typename K, typename V, typename Augment, typename Compare>
+int splay_tree<K,V,Augment,Compare>::compare(const K& key, const prefix_type& prefix, const tree_node* node) {
+    if constexpr (prefix_traits::enabled) {
+        if (prefix != node->m_prefix) {
+            return prefix < node->m_prefix ? -1 : 1;
+        }
     }
-    nodeX->m_right = nodeY->m_left;
+    auto order = Compare{}(key, node->m_key);
+    return order < 0 ? -1 : (order > 0 ? 1 : 0);
+}
 
-    if (nodeY->m_left != nullptr) {
-        (nodeY->m_left)->m_parent = nodeX;
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::splay(const K& key, const size_t depth, tree_node* inserted) {
+    splay_subtree(m_root, key, depth, inserted);
+}
+
+//top-down splay of the node holding key, at the given depth below top, up to top
+//nodes passed on the way down are hung off a left tree (smaller keys) and a right tree (larger keys),
+//which become the children of the splayed node; with inserted set, that node takes the empty link
+//where key belongs and is splayed instead
+//bottom-up splaying pairs the rotations from the node upwards and does any lone zig at the root,
+//so the pairs are aligned the same way here to produce exactly the same tree
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::splay_subtree(tree_node*& top, const K& key, const size_t depth,
+                                            tree_node* inserted) {
+    tree_node* leftTree = nullptr;
+    tree_node* rightTree = nullptr;
+    //the empty links where the next nodes join the left and right trees
+    tree_node** leftHook = &leftTree;
+    tree_node** rightHook = &rightTree;
+    tree_node* current = top;
+    //nodes hung on each tree, whose aggregates are repaired once the trees are complete
+    size_t leftCount = 0;
+    size_t rightCount = 0;
+    prefix_type prefix = prefix_traits::of(key);
+
+    size_t zigZigs = 0;
+    if (depth % 2 == 1) {
+        //zig
+        if (compare(key, prefix, current) < 0) {
+            *rightHook = current;
+            rightHook = &current->m_left;
+            current = current->m_left;
+            rightCount++;
+        } else {
+            *leftHook = current;
+            leftHook = &current->m_right;
+            current = current->m_right;
+            leftCount++;
+        }
     }
-    nodeY->m_parent = nodeX->m_parent;
 
-    std::shared_ptr<splay_tree_node> parentX = nodeX->m_parent.lock();
-    if (parentX != nullptr) {
-        if (parentX->m_left == nodeX) {
-            parentX->m_left = nodeY;
+    //the remaining depth is even, so the node is never the child of current
+    int order = 0;
+    while (current != nullptr && (order = compare(key, prefix, current)) != 0) {
+        if (order < 0) {
+            tree_node* child = current->m_left;
+            if (compare(key, prefix, child) < 0) {
+                //zig-zig: rotate child above current, then hang it on the right tree
+                current->m_left = child->m_right;
+                child->m_right = current;
+                pull(current);
+                *rightHook = child;
+                rightHook = &child->m_left;
+                current = child->m_left;
+                rightCount++;
+                zigZigs++;
+            } else {
+                //zig-zag
+                *rightHook = current;
+                rightHook = &current->m_left;
+                *leftHook = child;
+                leftHook = &child->m_right;
+                current = child->m_right;
+                leftCount++;
+                rightCount++;
+            }
         } else {
-            parentX->m_right = nodeY;
+            tree_node* child = current->m_right;
+            if (compare(key, prefix, child) > 0) {
+                //zig-zig
+                current->m_right = child->m_left;
+                child->m_left = current;
+                pull(current);
+                *leftHook = child;
+                leftHook = &child->m_right;
+                current = child->m_right;
+                leftCount++;
+                zigZigs++;
+            } else {
+                //zig-zag
+                *leftHook = current;
+                leftHook = &current->m_right;
+                *rightHook = child;
+                rightHook = &child->m_left;
+                current = child->m_left;
+                leftCount++;
+                rightCount++;
+            }
         }
-    } else {
-        m_root = nodeY;
     }
-    nodeY->m_left = nodeX;
-    nodeX->m_parent = nodeY;
+
+    if (current == nullptr) {
+        current = inserted;
+    }
+    *leftHook = current->m_left;
+    *rightHook = current->m_right;
+    current->m_left = leftTree;
+    current->m_right = rightTree;
+    if constexpr (augmented) {
+        //the left tree grew down its right spine and the right tree down its left spine
+        pull_spine(leftTree, leftCount, &tree_node::m_right);
+        pull_spine(rightTree, rightCount, &tree_node::m_left);
+        pull(current);
+    }
+    top = current;
+    count_splay(depth, zigZigs);
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::count_operation() {
+#ifdef CS251_SPLAY_STATS
+    m_counters.m_operations++;
+#endif
 }
 
-template <typename K, typename V>
-void splay_tree<K,V>::zig(std::shared_ptr<splay_tree_node>& current) {
-    std::shared_ptr<splay_tree_node> parent = current->m_parent.lock();
+//a splay from the given depth takes depth % 2 zigs, and its other steps are zig-zigs or zig-zags
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::count_splay(const size_t depth, const size_t zigZigs) {
+#ifdef CS251_SPLAY_STATS
+    m_counters.m_splays++;
+    m_counters.m_pathLength += depth;
+    m_counters.m_zigs += depth % 2;
+    m_counters.m_zigZigs += zigZigs;
+    m_counters.m_zigZags += depth / 2 - zigZigs;
+#else
+    (void)depth;
+    (void)zigZigs;
+#endif
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+splay_tree<K,V,Augment,Compare>::splay_tree() {
+    m_numElements = 0;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+splay_tree<K,V,Augment,Compare>::splay_tree(std::shared_ptr<node_pool<tree_node>> pool) : m_pool(std::move(pool)) {
+    m_numElements = 0;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+splay_tree<K,V,Augment,Compare>::splay_tree(splay_tree&& other) noexcept
+    : m_root(std::exchange(other.m_root, nullptr)), m_pool(std::move(other.m_pool)),
+      m_min(std::exchange(other.m_min, nullptr)), m_max(std::exchange(other.m_max, nullptr)),
+      m_numElements(std::exchange(other.m_numElements, 0)), m_policy(other.m_policy),
+      m_policyState(other.m_policyState), m_stats(std::move(other.m_stats)) {
+#ifdef CS251_SPLAY_STATS
+    m_counters = std::exchange(other.m_counters, splay_counters());
+#endif
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+splay_tree<K,V,Augment,Compare>& splay_tree<K,V,Augment,Compare>::operator=(splay_tree&& other) noexcept {
+    if (this != &other) {
+        clear();
+        m_root = std::exchange(other.m_root, nullptr);
+        m_pool = std::move(other.m_pool);
+        m_min = std::exchange(other.m_min, nullptr);
+        m_max = std::exchange(other.m_max, nullptr);
+        m_numElements = std::exchange(other.m_numElements, 0);
+        m_policy = other.m_policy;
+        m_policyState = other.m_policyState;
+        m_stats = std::move(other.m_stats);
+#ifdef CS251_SPLAY_STATS
+        m_counters = std::exchange(other.m_counters, splay_counters());
+#endif
+    }
+    return *this;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+splay_tree<K,V,Augment,Compare>::~splay_tree() {
+    clear();
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::insert(const K& key, std::unique_ptr<V> value) {
+    if (!try_insert(key, std::move(value))) {
+        throw duplicate_key();
+    }
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+const std::unique_ptr<V>& splay_tree<K,V,Augment,Compare>::peek(const K& key) {
+    const std::unique_ptr<V>* value = find(key);
+    if (value == nullptr) {
+        throw nonexistent_key();
+    }
+    return *value;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+std::unique_ptr<V> splay_tree<K,V,Augment,Compare>::extract(const K& key) {
+    std::optional<std::unique_ptr<V>> value = try_extract(key);
+    if (!value) {
+        throw nonexistent_key();
+    }
+    return std::move(*value);
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+bool splay_tree<K,V,Augment,Compare>::try_insert(const K& key, std::unique_ptr<V> value) {
+    count_operation();
+    //a key beyond the root on a side where the root has no child becomes the new root, which is the
+    //single zig the splay would do; ascending and descending runs then cost one comparison per insert
+    if (m_root != nullptr && (m_root->m_left == nullptr || m_root->m_right == nullptr)) {
+        int order = compare(key, prefix_traits::of(key), m_root);
+        if (order == 0) {
+            return false;
+        }
+        if ((order < 0 ? m_root->m_left : m_root->m_right) == nullptr) {
+            tree_node* current = pool().allocate();
+            set_key(current, key);
+            current->m_value = std::move(value);
+            //the root had nothing on that side, so it was the extreme the new node replaces
+            if (order < 0) {
+                current->m_right = m_root;
+                m_min = current;
+            } else {
+                current->m_left = m_root;
+                m_max = current;
+            }
+            pull(current);
+            m_root = current;
+            m_numElements++;
+            count_splay(1, 0);
+            return true;
+        }
+    }
+
+    size_t depth = 0;
+    if (probe(key, depth) != nullptr) {
+        return false;
+    }
+
+    tree_node* current = pool().allocate();
+    set_key(current, key);
+    current->m_value = std::move(value);
 
-    if (parent->m_left == current) {
-        rightRotation(parent);
+    if (empty()) {
+        pull(current);
+        m_root = current;
+        m_min = current;
+        m_max = current;
     } else {
-        leftRotation(parent);
+        if (m_min != nullptr && compare(key, current->m_prefix, m_min) < 0) {
+            m_min = current;
+        } else if (m_max != nullptr && compare(key, current->m_prefix, m_max) > 0) {
+            m_max = current;
+        }
+        //splaying the new node also links it in where it belongs
+        splay(current->m_key, depth, current);
     }
+    m_numElements++;
+    return true;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::tree_node* splay_tree<K,V,Augment,Compare>::find_node(const K& key) const {
+    size_t depth = 0;
+    return probe(key, depth);
 }
 
-template <typename K, typename V>
-void splay_tree<K,V>::zigZig(std::shared_ptr<splay_tree_node>& current) {
-    std::shared_ptr<splay_tree_node> parent = current->m_parent.lock();
-    std::shared_ptr<splay_tree_node> grandparent = parent->m_parent.lock();
+template <typename K, typename V, typename Augment, typename Compare>
+const std::unique_ptr<V>* splay_tree<K,V,Augment,Compare>::find(const K& key) {
+    count_operation();
+    size_t depth = 0;
+    tree_node* current = probe(key, depth);
+    if (current == nullptr) {
+        return nullptr;
+    }
 
-    if (parent != nullptr && grandparent != nullptr) {
-        if (((grandparent->m_left == parent) && (parent->m_left == current))) {
-            rightRotation(grandparent);
-            rightRotation(parent);
-        } else {
-            leftRotation(grandparent);
-            leftRotation(parent);
+    if (m_policy.m_mode == splay_policy::mode::semi) {
+        //splaying below the halfway ancestor leaves every subtree above it with the same nodes
+        tree_node** top = &m_root;
+        prefix_type prefix = prefix_traits::of(key);
+        for (size_t i = 0; i < depth / 2; i++) {
+            top = compare(key, prefix, *top) < 0 ? &(*top)->m_left : &(*top)->m_right;
         }
+        splay_subtree(*top, key, depth - depth / 2, nullptr);
+    } else if (should_splay(depth)) {
+        splay(key, depth);
     }
+
+    if (m_stats != nullptr) {
+        record_access(current, depth);
+    }
+    return &current->m_value;
 }
 
-template <typename K, typename V>
-void splay_tree<K,V>::zigZag(std::shared_ptr<splay_tree_node>& current) {
-    std::shared_ptr<splay_tree_node> parent = current->m_parent.lock();
-    std::shared_ptr<splay_tree_node> grandparent = parent->m_parent.lock();
+template <typename K, typename V, typename Augment, typename Compare>
+template <typename Range>
+std::vector<const std::unique_ptr<V>*> splay_tree<K,V,Augment,Compare>::peek_many(const Range& keys) const {
+    std::vector<const K*> batch;
+    if constexpr (std::ranges::sized_range<const Range>) {
+        batch.reserve(std::ranges::size(keys));
+    }
+    for (const K& key : keys) {
+        batch.push_back(&key);
+    }
+    std::vector<const std::unique_ptr<V>*> values(batch.size(), nullptr);
+    if (m_root == nullptr) {
+        return values;
+    }
+
+    std::vector<size_t> order(batch.size());
+    std::iota(order.begin(), order.end(), 0);
+    auto before = [&](size_t a, size_t b) { return less(*batch[a], *batch[b]); };
+    if (!std::is_sorted(order.begin(), order.end(), before)) {
+        std::stable_sort(order.begin(), order.end(), before);
+    }
 
-    if (parent != nullptr && grandparent != nullptr) {
-        if ((grandparent->m_left == parent) && (parent->m_right == current)) {
-            leftRotation(parent);
-            rightRotation(grandparent);
-        } else {
-            rightRotation(parent);
-            leftRotation(grandparent);
+    //the path from the root to the last node visited, each node with the nearest ancestor above its
+    //subtree's keys; the keys come in increasing order, so only those upper bounds can stop holding
+    struct level {
+        const tree_node* m_node;
+        const tree_node* m_high;
+    };
+    std::vector<level> path;
+    path.push_back(level{m_root, nullptr});
+    for (size_t i : order) {
+        const K& key = *batch[i];
+        prefix_type prefix = prefix_traits::of(key);
+        while (path.back().m_high != nullptr && compare(key, prefix, path.back().m_high) >= 0) {
+            path.pop_back();
+        }
+
+        const tree_node* current = path.back().m_node;
+        while (true) {
+            int direction = compare(key, prefix, current);
+            if (direction == 0) {
+                values[i] = &current->m_value;
+                break;
+            }
+            const tree_node* child = direction < 0 ? current->m_left : current->m_right;
+            if (child == nullptr) {
+                break;
+            }
+            path.push_back(level{child, direction < 0 ? current : path.back().m_high});
+            current = child;
         }
     }
+    return values;
 }
 
-//splay the key up to the root
-template <typename K, typename V>
-void splay_tree<K,V>::splay(std::shared_ptr<splay_tree_node>& current) {
-    while (current != m_root) {
-        std::shared_ptr<splay_tree_node> parent = current->m_parent.lock();
+template <typename K, typename V, typename Augment, typename Compare>
+bool splay_tree<K,V,Augment,Compare>::should_splay(const size_t depth) {
+    switch (m_policy.m_mode) {
+        case splay_policy::mode::every_kth:
+            return ++m_policyState % std::max<uint32_t>(m_policy.m_period, 1) == 0;
+        case splay_policy::mode::probability:
+            m_policyState ^= m_policyState << 13;
+            m_policyState ^= m_policyState >> 17;
+            m_policyState ^= m_policyState << 5;
+            return m_policyState < m_policy.m_probability * 4294967296.0;
+        case splay_policy::mode::depth_threshold:
+            return depth > m_policy.m_depthFactor * std::bit_width(m_numElements);
+        default:
+            return true;
+    }
+}
 
-        if (!parent) {
-            break;
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::set_splay_policy(const splay_policy& policy) {
+    m_policy = policy;
+    //xorshift needs a nonzero seed
+    m_policyState = policy.m_mode == splay_policy::mode::probability ? 2463534242u : 0;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+const splay_policy& splay_tree<K,V,Augment,Compare>::get_splay_policy() const {
+    return m_policy;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::set_access_tracking(const bool enabled) {
+    if (!enabled) {
+        m_stats.reset();
+    } else if (m_stats == nullptr) {
+        m_stats = std::make_unique<access_stats>();
+    }
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::set_auto_rebuild(const size_t interval, const double slack) {
+    set_access_tracking(true);
+    m_stats->m_interval = interval;
+    m_stats->m_slack = slack;
+    m_stats->m_hits = 0;
+    m_stats->m_depthSum = 0;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::record_access(tree_node* node, const size_t depth) {
+    if (node->m_accesses != std::numeric_limits<uint32_t>::max()) {
+        node->m_accesses++;
+    }
+    //depth is measured in comparisons, as the bound is
+    m_stats->m_hits++;
+    m_stats->m_depthSum += depth + 1;
+
+    //checking costs O(n), so it waits for at least n hits
+    if (m_stats->m_interval == 0 || m_stats->m_hits < std::max(m_stats->m_interval, m_numElements)) {
+        return;
+    }
+    double averageDepth = static_cast<double>(m_stats->m_depthSum) / m_stats->m_hits;
+    m_stats->m_hits = 0;
+    m_stats->m_depthSum = 0;
+    if (averageDepth > m_stats->m_slack * entropy_bound()) {
+        rebuild_weighted();
+    }
+}
+
+//expected comparisons per access of a weight-balanced tree for the current counts: H + 2
+template <typename K, typename V, typename Augment, typename Compare>
+double splay_tree<K,V,Augment,Compare>::entropy_bound() const {
+    double total = 0;
+    for (const_iterator it = begin(); it != end(); ++it) {
+        total += it->m_accesses + 1.0;
+    }
+    double entropy = 0;
+    for (const_iterator it = begin(); it != end(); ++it) {
+        double weight = it->m_accesses + 1.0;
+        entropy += weight / total * std::log2(total / weight);
+    }
+    return entropy + 2;
+}
+
+//Mehlhorn's bisection: each subtree is rooted at the node whose weight interval holds the middle of the
+//subtree's total weight; searching for it from both ends at once keeps the whole build O(n)
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::rebuild_weighted() {
+    node_list nodes = detach_nodes();
+    size_t count = nodes.size();
+    //prefix[i] is the weight of the nodes before i
+    std::vector<double> prefix(count + 1, 0.0);
+    for (size_t i = 0; i < count; i++) {
+        prefix[i + 1] = prefix[i] + nodes[i]->m_accesses + 1.0;
+        nodes[i]->m_accesses /= 2;
+    }
+
+    struct build_task {
+        size_t m_begin;
+        size_t m_end;
+        tree_node** m_link;
+    };
+    //skewed weights can make the tree deep, so the build uses an explicit stack
+    std::vector<build_task> tasks;
+    tasks.push_back(build_task{0, count, &m_root});
+    node_list preorder;
+    preorder.reserve(count);
+    while (!tasks.empty()) {
+        build_task task = tasks.back();
+        tasks.pop_back();
+        if (task.m_begin >= task.m_end) {
+            *task.m_link = nullptr;
+            continue;
         }
-        std::shared_ptr<splay_tree_node> grandparent = parent->m_parent.lock();
-        if (grandparent == nullptr) {
-            zig(current);
-        } else if (((grandparent->m_left == parent) && (parent->m_left == current)) ||
-                   ((grandparent->m_right == parent) && (parent->m_right == current))) {
-            zigZig(current);
-        } else {
-            zigZag(current);
+
+        //find the first i with prefix[i + 1] > middle; it is never past the last node
+        double middle = (prefix[task.m_begin] + prefix[task.m_end]) / 2;
+        auto past = [&](size_t i) { return prefix[i + 1] > middle; };
+        size_t low = task.m_begin;
+        size_t high = task.m_end - 1;
+        for (size_t step = 1; low < high; step *= 2) {
+            size_t fromLow = task.m_begin + step - 1;
+            if (fromLow >= high) {
+                break;
+            }
+            if (past(fromLow)) {
+                high = fromLow;
+                break;
+            }
+            low = fromLow + 1;
+
+            size_t fromHigh = task.m_end - 1 - step;
+            if (fromHigh < low) {
+                break;
+            }
+            if (!past(fromHigh)) {
+                low = fromHigh + 1;
+                break;
+            }
+            high = fromHigh;
         }
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if (past(mid)) {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+
+        tree_node* node = nodes[low];
+        *task.m_link = node;
+        preorder.push_back(node);
+        tasks.push_back(build_task{task.m_begin, low, &node->m_left});
+        tasks.push_back(build_task{low + 1, task.m_end, &node->m_right});
     }
 
+    //children come after their parents in preorder
+    for (size_t i = preorder.size(); i > 0; i--) {
+        pull(preorder[i - 1]);
+    }
+    m_min = count > 0 ? nodes.front() : nullptr;
+    m_max = count > 0 ? nodes.back() : nullptr;
+    m_numElements = count;
 }
 
-template <typename K, typename V>
-splay_tree<K,V>::splay_tree() {
-    m_numElements = 0;
+template <typename K, typename V, typename Augment, typename Compare>
+std::optional<std::unique_ptr<V>> splay_tree<K,V,Augment,Compare>::try_extract(const K& key) {
+    count_operation();
+    size_t depth = 0;
+    tree_node* current = probe(key, depth);
+    if (current == nullptr) {
+        return std::nullopt;
+    }
+    splay(key, depth);
+    std::unique_ptr<V> nodeValue = std::move(current->m_value);
+
+    if (current->m_right != nullptr && current->m_left != nullptr) {
+        tree_node* successor = current->m_right;
+        tree_node* successorParent = current;
+        size_t successorDepth = 0;
+        while (successor->m_left != nullptr) {
+            successorParent = successor;
+            successor = successor->m_left;
+            successorDepth++;
+        }
+
+        if (successor != current->m_right) {
+            successorParent->m_left = successor->m_right;
+            successor->m_right = current->m_right;
+            pull_spine(successor->m_right, successorDepth, &tree_node::m_left);
+        }
+
+        successor->m_left = current->m_left;
+        pull(successor);
+        m_root = successor;
+
+    } else if (current->m_right != nullptr) {
+        //if only right child just take immediate right regardless if the right subtree has left children
+        m_root = current->m_right;
+
+    } else {
+        //no right successor, use left child (or nothing)
+        m_root = current->m_left;
+    }
+
+    //the next extreme ends the spine below the new root; rather than walk it here, it is found
+    //by splaying the next time it is asked for, which pays for the walk
+    if (current == m_min) {
+        m_min = nullptr;
+    }
+    if (current == m_max) {
+        m_max = nullptr;
+    }
+    m_numElements--;
+    m_pool->release(current);
+    return nodeValue;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+size_t splay_tree<K,V,Augment,Compare>::merge(splay_tree& other, const merge_policy policy) {
+    if (&other == this || other.empty()) {
+        return 0;
+    }
+
+    //ranges that do not interleave (time-partitioned keys, say) are spliced in instead of rebuilt
+    K otherMin = other.minimum_key();
+    K otherMax = other.maximum_key();
+    splay_tree upper = split_off(otherMin, true);
+    if (upper.empty() || less(otherMax, upper.minimum_key())) {
+        size_t moved = other.size();
+        append(other);
+        append(upper);
+        return moved;
+    }
+    append(upper);
+
+    node_list mine = detach_nodes();
+    node_list theirs = other.detach_nodes();
+    node_list merged;
+    node_list leftovers;
+    node_pool<tree_node>* source = other.m_pool.get();
+    if (policy != merge_policy::collect && other.m_pool.use_count() == 1) {
+        //other ends up empty and nothing else allocates from its pool, so its slabs can simply become ours
+        pool().absorb(*source);
+        source = m_pool.get();
+    }
+    //otherwise only the moved nodes are copied into our pool
+    size_t moved = merge_sorted(mine, theirs, *source, policy, merged, leftovers);
+
+    attach_sorted(merged);
+    other.attach_sorted(leftovers);
+    return moved;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+size_t splay_tree<K,V,Augment,Compare>::merge(splay_tree&& other, const merge_policy policy) {
+    return merge(other, policy);
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+splay_tree<K,V,Augment,Compare> splay_tree<K,V,Augment,Compare>::split(const K& key) {
+    return split_off(key, true);
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+splay_tree<K,V,Augment,Compare> splay_tree<K,V,Augment,Compare>::join(splay_tree&& left, splay_tree&& right) {
+    left.append(right);
+    return std::move(left);
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+splay_tree<K,V,Augment,Compare> splay_tree<K,V,Augment,Compare>::extract_range(const K& lo, const K& hi) {
+    splay_tree range = split_off(lo, true);
+    splay_tree upper = range.split_off(hi, false);
+    append(upper);
+    return range;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+template <typename Range>
+splay_tree<K,V,Augment,Compare> splay_tree<K,V,Augment,Compare>::build_sorted(Range&& range) {
+    splay_tree tree;
+    node_list nodes;
+    if constexpr (std::ranges::sized_range<Range>) {
+        nodes.reserve(std::ranges::size(range));
+    }
+
+    //nodes allocated before a throw still belong to the tree's pool, which frees them
+    for (auto&& [key, value] : range) {
+        int order = nodes.empty() ? 1 : compare(key, prefix_traits::of(key), nodes.back());
+        if (order <= 0) {
+            if (order == 0) {
+                throw duplicate_key();
+            }
+            throw std::invalid_argument("build_sorted requires keys in increasing order");
+        }
+        tree_node* node = tree.pool().allocate();
+        set_key(node, key);
+        node->m_value = std::move(value);
+        nodes.push_back(node);
+    }
+    tree.attach_sorted(nodes);
+    return tree;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+template <typename Range>
+splay_tree<K,V,Augment,Compare> splay_tree<K,V,Augment,Compare>::build(Range&& range, const bool parallel) {
+    entry_list entries;
+    if constexpr (std::ranges::sized_range<Range>) {
+        entries.reserve(std::ranges::size(range));
+    }
+    for (auto&& [key, value] : range) {
+        entries.emplace_back(key, std::move(value));
+    }
+
+    sort_entries(entries, parallel);
+    return build_sorted(entries);
+}
+
+//sort entries by key; in parallel, chunks are sorted on their own threads and then merged pairwise
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::sort_entries(entry_list& entries, const bool parallel) {
+    auto byKey = [](const auto& a, const auto& b) { return less(a.first, b.first); };
+    size_t chunks = parallel ? std::min<size_t>(std::thread::hardware_concurrency(), entries.size() / parallel_grain) : 1;
+    if (chunks <= 1) {
+        std::sort(entries.begin(), entries.end(), byKey);
+        return;
+    }
+
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t i = 0; i <= chunks; i++) {
+        bounds[i] = entries.size() * i / chunks;
+    }
+    auto start = entries.begin();
+    {
+        std::vector<std::jthread> workers;
+        for (size_t i = 0; i < chunks; i++) {
+            workers.emplace_back([=]() { std::sort(start + bounds[i], start + bounds[i + 1], byKey); });
+        }
+    }
+    for (size_t width = 1; width < chunks; width *= 2) {
+        std::vector<std::jthread> workers;
+        for (size_t i = 0; i + width < chunks; i += 2 * width) {
+            size_t end = bounds[std::min(i + 2 * width, chunks)];
+            workers.emplace_back([=]() { std::inplace_merge(start + bounds[i], start + bounds[i + width], start + end, byKey); });
+        }
+    }
+}
+
+//move the entries from the first key greater than key (or equal to it, if inclusive) onwards into a new tree
+template <typename K, typename V, typename Augment, typename Compare>
+splay_tree<K,V,Augment,Compare> splay_tree<K,V,Augment,Compare>::split_off(const K& key, const bool inclusive) {
+    splay_tree upper(m_pool);
+    upper.set_splay_policy(m_policy);
+    size_t depth = 0;
+    tree_node* bound = find_bound(key, inclusive, depth);
+    if (bound == nullptr) {
+        //the search ran down the right spine, so splay its end to pay for it
+        if (!empty()) {
+            maximum_key();
+        }
+        return upper;
+    }
+
+    //after splaying, the bound and its right subtree are exactly the entries to move
+    splay(bound->m_key, depth);
+    upper.m_root = m_root;
+    m_root = m_root->m_left;
+    upper.m_root->m_left = nullptr;
+    pull(upper.m_root);
+    upper.m_min = upper.m_root;
+    upper.m_max = m_max;
+
+    if constexpr (counted) {
+        upper.m_numElements = Augment::count(upper.m_root->m_aggregate);
+    } else {
+        upper.m_numElements = m_numElements - count_first(m_root, upper.m_root, m_numElements);
+    }
+    m_numElements -= upper.m_numElements;
+    //the new maximum ends the right spine of what is left, so splay it up to pay for the walk
+    if (m_root != nullptr) {
+        maximum_key();
+        m_max = m_root;
+    } else {
+        m_min = nullptr;
+        m_max = nullptr;
+    }
+    return upper;
 }
 
-template <typename K, typename V>
-void splay_tree<K,V>::insert(const K& key, std::unique_ptr<V> value) {
+//link right, whose keys must all be greater than ours, in below our maximum
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::append(splay_tree& right) {
+    if (right.empty()) {
+        return;
+    }
+    if (!empty()) {
+        maximum_key();
+        right.minimum_key();
+        if (!less(m_root->m_key, right.m_root->m_key)) {
+            throw std::invalid_argument("join requires every key of left to be less than every key of right");
+        }
+    }
+
+    share_pool(right);
     if (empty()) {
-        m_root = std::make_shared<splay_tree_node>();
-        m_root->m_value = std::move(value);
-        m_root->m_key = key;
-        m_root->m_parent = std::weak_ptr<splay_tree_node>();
-        m_root->m_left = nullptr;
-        m_root->m_right = nullptr;
+        m_root = right.m_root;
+        m_min = right.m_min;
     } else {
-        std::shared_ptr<splay_tree_node> current = m_root;
-        std::shared_ptr<splay_tree_node> parent = current;
+        m_root->m_right = right.m_root;
+        pull(m_root);
+    }
+    m_max = right.m_max;
+    m_numElements += right.m_numElements;
+    right.m_root = nullptr;
+    right.m_min = nullptr;
+    right.m_max = nullptr;
+    right.m_numElements = 0;
+}
+
+//make every node of other come from our pool, so that its nodes can be linked into this tree
+//other keeps its own pool, which may be shared with the buckets of another table, so the caller
+//must take every node of other before other allocates or releases any
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::share_pool(splay_tree& other) {
+    if (other.m_pool == m_pool) {
+        return;
+    }
+    if (other.m_pool.use_count() == 1) {
+        //nothing else allocates from the pool of other, so its slabs can simply become ours and
+        //other is left with an empty pool
+        pool().absorb(*other.m_pool);
+        return;
+    }
+
+    node_list nodes = other.detach_nodes();
+    for (auto& node : nodes) {
+        node = adopt(node, *other.m_pool);
+    }
+    other.attach_sorted(nodes);
+}
 
-        //traverse through tree
+//drop every node without handing it back, for a caller about to destroy the pool along with them
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::forget_nodes() {
+    m_root = nullptr;
+    m_min = nullptr;
+    m_max = nullptr;
+    m_numElements = 0;
+}
+
+//count the nodes of first, given that first and second hold total nodes between them
+//both are walked in step, so this costs O(min(|first|, |second|))
+template <typename K, typename V, typename Augment, typename Compare>
+size_t splay_tree<K,V,Augment,Compare>::count_first(const tree_node* first, const tree_node* second,
+                                            const size_t total) {
+    const_iterator a;
+    const_iterator b;
+    a.push_left(first);
+    b.push_left(second);
+    size_t count = 0;
+    while (true) {
+        if (a == const_iterator()) {
+            return count;
+        }
+        if (b == const_iterator()) {
+            return total - count;
+        }
+        ++a;
+        ++b;
+        count++;
+    }
+}
+
+//unlink every node in key order and leave the tree empty
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::node_list splay_tree<K,V,Augment,Compare>::detach_nodes() {
+    node_list nodes;
+    nodes.reserve(m_numElements);
+
+    //iterative in-order traversal so deep trees cannot overflow the stack
+    node_list stack;
+    tree_node* current = m_root;
+    while (current != nullptr || !stack.empty()) {
         while (current != nullptr) {
-            parent = current;
+            stack.push_back(current);
+            current = current->m_left;
+        }
+        current = stack.back();
+        stack.pop_back();
+        nodes.push_back(current);
+        current = current->m_right;
+    }
 
-            if (current->m_key == key) {
-                throw duplicate_key();
-            }
+    for (auto& node : nodes) {
+        node->m_left = nullptr;
+        node->m_right = nullptr;
+    }
+    m_root = nullptr;
+    m_min = nullptr;
+    m_max = nullptr;
+    m_numElements = 0;
+    return nodes;
+}
+
+//replace the contents of an empty tree with a balanced tree of nodes sorted by key
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::attach_sorted(node_list& nodes) {
+    m_root = build_balanced(nodes, 0, nodes.size());
+    m_min = nodes.empty() ? nullptr : nodes.front();
+    m_max = nodes.empty() ? nullptr : nodes.back();
+    m_numElements = nodes.size();
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::tree_node* splay_tree<K,V,Augment,Compare>::build_balanced(
+        node_list& nodes, const size_t begin, const size_t end) {
+    if (begin >= end) {
+        return nullptr;
+    }
+
+    size_t middle = begin + (end - begin) / 2;
+    tree_node* node = nodes[middle];
+    node->m_left = build_balanced(nodes, begin, middle);
+    node->m_right = build_balanced(nodes, middle + 1, end);
+    pull(node);
+    return node;
+}
 
-            if (key < current->m_key) {
-                current = current->m_left;
+template <typename K, typename V, typename Augment, typename Compare>
+node_pool<typename splay_tree<K,V,Augment,Compare>::tree_node>& splay_tree<K,V,Augment,Compare>::pool() {
+    if (m_pool == nullptr) {
+        m_pool = std::make_shared<node_pool<tree_node>>();
+    }
+    return *m_pool;
+}
+
+//move a node allocated from another pool into this tree's pool
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::tree_node* splay_tree<K,V,Augment,Compare>::adopt(tree_node* node, node_pool<tree_node>& source) {
+    if (&source == m_pool.get()) {
+        return node;
+    }
+    tree_node* copy = pool().allocate();
+    set_key(copy, std::move(node->m_key));
+    copy->m_value = std::move(node->m_value);
+    source.release(node);
+    return copy;
+}
+
+//merge two key-sorted node lists; theirs were allocated from source
+//conflicting incoming nodes are released, or kept in leftovers for collect
+template <typename K, typename V, typename Augment, typename Compare>
+size_t splay_tree<K,V,Augment,Compare>::merge_sorted(node_list& mine, node_list& theirs, node_pool<tree_node>& source,
+                                     const merge_policy policy, node_list& merged, node_list& leftovers) {
+    size_t moved = 0;
+    size_t i = 0;
+    size_t j = 0;
+    merged.reserve(mine.size() + theirs.size());
+
+    while (i < mine.size() || j < theirs.size()) {
+        int order = i == mine.size() ? 1 : (j == theirs.size() ? -1 : compare(mine[i]->m_key, mine[i]->m_prefix, theirs[j]));
+        if (order < 0) {
+            merged.push_back(mine[i++]);
+        } else if (order > 0) {
+            merged.push_back(adopt(theirs[j++], source));
+            moved++;
+        } else {
+            if (policy == merge_policy::collect) {
+                leftovers.push_back(theirs[j]);
             } else {
-                current = current->m_right;
+                if (policy == merge_policy::overwrite) {
+                    mine[i]->m_value = std::move(theirs[j]->m_value);
+                }
+                source.release(theirs[j]);
             }
+            merged.push_back(mine[i++]);
+            j++;
         }
+    }
+    return moved;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::const_iterator::reference splay_tree<K,V,Augment,Compare>::const_iterator::operator*() const {
+    return *m_path.back();
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::const_iterator::pointer splay_tree<K,V,Augment,Compare>::const_iterator::operator->() const {
+    return m_path.back();
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::const_iterator& splay_tree<K,V,Augment,Compare>::const_iterator::operator++() {
+    const tree_node* current = m_path.back();
+    m_path.pop_back();
+    push_left(current->m_right);
+    return *this;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::const_iterator splay_tree<K,V,Augment,Compare>::const_iterator::operator++(int) {
+    const_iterator previous = *this;
+    ++*this;
+    return previous;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+bool splay_tree<K,V,Augment,Compare>::const_iterator::operator==(const const_iterator& other) const {
+    if (m_path.empty() || other.m_path.empty()) {
+        return m_path.empty() == other.m_path.empty();
+    }
+    return m_path.back() == other.m_path.back();
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::const_iterator::push_left(const tree_node* node) {
+    while (node != nullptr) {
+        m_path.push_back(node);
+        node = node->m_left;
+    }
+}
 
-        current = std::make_shared<splay_tree_node>();
-        current->m_key = std::move(key);
-        current->m_value = std::move(value);
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::const_iterator splay_tree<K,V,Augment,Compare>::begin() const {
+    const_iterator it;
+    it.push_left(m_root);
+    return it;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::const_iterator splay_tree<K,V,Augment,Compare>::end() const {
+    return const_iterator();
+}
 
-        current->m_parent = parent;
-        current->m_right = nullptr;
-        current->m_left = nullptr;
+//return the first node whose key is greater than key (or equal to it, if inclusive), or nullptr
+//depth is set to the depth of that node
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::tree_node* splay_tree<K,V,Augment,Compare>::find_bound(const K& key, const bool inclusive,
+                                                                     size_t& depth) const {
+    tree_node* bound = nullptr;
+    tree_node* current = m_root;
+    prefix_type prefix = prefix_traits::of(key);
+    size_t currentDepth = 0;
 
-        if (key < parent->m_key) {
-            parent->m_left = current;
+    while (current != nullptr) {
+        int order = compare(key, prefix, current);
+        if (order < 0 || (inclusive && order == 0)) {
+            bound = current;
+            depth = currentDepth;
+            current = current->m_left;
         } else {
-            parent->m_right = current;
+            current = current->m_right;
         }
+        currentDepth++;
+    }
+    return bound;
+}
 
-        splay(current);
+//splay the bound to the root; everything after it is then in its right subtree
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::const_iterator splay_tree<K,V,Augment,Compare>::splay_bound(tree_node* bound, const size_t depth) {
+    if (bound == nullptr) {
+        return end();
     }
-    m_numElements++;
+    splay(bound->m_key, depth);
+    const_iterator it;
+    it.m_path.push_back(m_root);
+    return it;
 }
 
-template <typename K, typename V>
-const std::unique_ptr<V>& splay_tree<K,V>::peek(const K& key) {
-    bool found = false;
-    std::shared_ptr<splay_tree_node> current = m_root;
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::const_iterator splay_tree<K,V,Augment,Compare>::lower_bound(const K& key) {
+    size_t depth = 0;
+    tree_node* bound = find_bound(key, true, depth);
+    return splay_bound(bound, depth);
+}
 
-    if (current != nullptr) {
-        if (m_numElements == 1 && current->m_key == key) {
-            found = true;
-        } else {
-            //traverse through tree
-            while (current != nullptr) {
-                if (current->m_key == key) {
-                    found = true;
-                    break;
-                }
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::const_iterator splay_tree<K,V,Augment,Compare>::upper_bound(const K& key) {
+    size_t depth = 0;
+    tree_node* bound = find_bound(key, false, depth);
+    return splay_bound(bound, depth);
+}
 
-                if (key < current->m_key) {
-                    current = current->m_left;
-                } else {
-                    current = current->m_right;
-                }
-            }
-        }
+template <typename K, typename V, typename Augment, typename Compare>
+template <typename Fn>
+void splay_tree<K,V,Augment,Compare>::for_each_in_range(const K& lo, const K& hi, Fn fn) {
+    for (const_iterator it = lower_bound(lo); it != end() && !less(hi, it->m_key); ++it) {
+        fn(it->m_key, it->m_value);
     }
+}
 
-    if (!found) {
-        throw nonexistent_key();
+template <typename K, typename V, typename Augment, typename Compare>
+template <typename Fn>
+void splay_tree<K,V,Augment,Compare>::for_each_with_prefix(const std::string_view prefix, Fn fn)
+        requires (prefix_scan<K>::enabled && natural_order) {
+    for (const_iterator it = lower_bound(prefix_scan<K>::lowest(prefix));
+         it != end() && prefix_scan<K>::matches(it->m_key, prefix); ++it) {
+        fn(it->m_key, it->m_value);
     }
-    splay(current);
-    return current->m_value;
 }
 
-template <typename K, typename V>
-std::unique_ptr<V> splay_tree<K,V>::extract(const K& key) {
-    bool found = false;
-    std::shared_ptr<splay_tree_node> current = m_root;
-    std::unique_ptr<V> nodeValue;
-    std::shared_ptr<splay_tree_node> successor;
+template <typename K, typename V, typename Augment, typename Compare>
+size_t splay_tree<K,V,Augment,Compare>::rank(const K& key)
+        requires requires (typename Augment::value_type a) { Augment::count(a); } {
+    size_t smaller = 0;
+    tree_node* current = m_root;
+    tree_node* last = nullptr;
+    size_t depth = 0;
 
     while (current != nullptr) {
-        if (current->m_key == key) {
-            found = true;
-            splay(current);
-            nodeValue = std::move(current->m_value);
-            break;
+        last = current;
+        if (less(current->m_key, key)) {
+            smaller += Augment::count(aggregate_of(current->m_left)) + 1;
+            current = current->m_right;
+        } else {
+            current = current->m_left;
         }
+        depth++;
+    }
+
+    if (last != nullptr) {
+        splay(last->m_key, depth - 1);
+    }
+    return smaller;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::const_iterator splay_tree<K,V,Augment,Compare>::select(size_t i)
+        requires requires (typename Augment::value_type a) { Augment::count(a); } {
+    if (i >= m_numElements) {
+        return end();
+    }
 
-        if (key < current->m_key) {
+    tree_node* current = m_root;
+    size_t depth = 0;
+    while (true) {
+        size_t leftCount = Augment::count(aggregate_of(current->m_left));
+        if (i == leftCount) {
+            break;
+        }
+        if (i < leftCount) {
             current = current->m_left;
         } else {
+            i -= leftCount + 1;
             current = current->m_right;
         }
+        depth++;
     }
+    return splay_bound(current, depth);
+}
 
-    if (found) {
-        if (current->m_right != nullptr && current->m_left != nullptr) {
-            successor = current->m_right;
-            while (successor->m_left != nullptr) {
-                successor = successor->m_left;
-            }
+//descend to the highest node inside [lo, hi], then collect whole subtrees along the paths to each end
+template <typename K, typename V, typename Augment, typename Compare>
+typename Augment::value_type splay_tree<K,V,Augment,Compare>::aggregate(const K& lo, const K& hi) {
+    tree_node* split = m_root;
+    tree_node* last = nullptr;
+    size_t depth = 0;
+    size_t lastDepth = 0;
 
-            if (successor != current->m_right) {
-                if (successor->m_right != nullptr) {
-                    (successor->m_right)->m_parent = successor->m_parent;
-                }
-                ((successor->m_parent).lock())->m_left = successor->m_right;
-                successor->m_right = current->m_right;
-                current->m_right->m_parent = successor;
-            }
+    while (split != nullptr && (less(split->m_key, lo) || less(hi, split->m_key))) {
+        last = split;
+        lastDepth = depth;
+        split = less(split->m_key, lo) ? split->m_right : split->m_left;
+        depth++;
+    }
+    if (split == nullptr) {
+        if (last != nullptr) {
+            splay(last->m_key, lastDepth);
+        }
+        return Augment::identity();
+    }
+
+    last = split;
+    lastDepth = depth;
+    size_t splitDepth = depth;
 
-            successor->m_left = current->m_left;
-            (current->m_left)->m_parent = successor;
-            m_root = successor;
-            successor->m_parent = std::weak_ptr<splay_tree_node>();
-            current->m_left = nullptr;
-            current->m_right = nullptr;
-
-        } else if (current->m_right != nullptr) {
-            //if only right child just take immediate right regardless if the right subtree has left children
-            (m_root->m_right)->m_parent = std::weak_ptr<splay_tree_node>();
-            m_root = m_root->m_right;
-
-        } else if (current->m_left != nullptr){
-            //no right successor, use left child
-            (m_root->m_left)->m_parent = std::weak_ptr<splay_tree_node>();
-            m_root = m_root->m_left;
+    //entries from lo up to split, built from the right as the walk moves to smaller keys
+    typename Augment::value_type lower = Augment::identity();
+    tree_node* current = split->m_left;
+    depth = splitDepth + 1;
+    while (current != nullptr) {
+        if (lastDepth < depth) {
+            last = current;
+            lastDepth = depth;
+        }
+        if (less(current->m_key, lo)) {
+            current = current->m_right;
         } else {
-            //no children
-            m_root = nullptr;
+            lower = Augment::combine(Augment::combine(Augment::of(current->m_key, current->m_value),
+                                                      aggregate_of(current->m_right)), lower);
+            current = current->m_left;
         }
-    } else {
-        //not found
-        throw nonexistent_key();
+        depth++;
     }
 
-    m_numElements--;
-    return nodeValue;
+    //entries after split up to hi, built from the left
+    typename Augment::value_type upper = Augment::identity();
+    current = split->m_right;
+    depth = splitDepth + 1;
+    while (current != nullptr) {
+        if (lastDepth < depth) {
+            last = current;
+            lastDepth = depth;
+        }
+        if (less(hi, current->m_key)) {
+            current = current->m_left;
+        } else {
+            upper = Augment::combine(upper, Augment::combine(aggregate_of(current->m_left),
+                                                             Augment::of(current->m_key, current->m_value)));
+            current = current->m_right;
+        }
+        depth++;
+    }
+
+    typename Augment::value_type result = Augment::combine(
+            Augment::combine(lower, Augment::of(split->m_key, split->m_value)), upper);
+    splay(last->m_key, lastDepth);
+    return result;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+auto splay_tree<K,V,Augment,Compare>::range_sum(const K& lo, const K& hi)
+        requires requires (typename Augment::value_type a) { Augment::sum(a); } {
+    return Augment::sum(aggregate(lo, hi));
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+typename Augment::value_type splay_tree<K,V,Augment,Compare>::aggregate_of(const tree_node* node) {
+    return node != nullptr ? node->m_aggregate : Augment::identity();
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::pull(tree_node* node) {
+    if constexpr (augmented) {
+        node->m_aggregate = Augment::combine(
+                Augment::combine(aggregate_of(node->m_left), Augment::of(node->m_key, node->m_value)),
+                aggregate_of(node->m_right));
+    }
+}
+
+//recompute the aggregates of the top count nodes of a spine that follows link, deepest first
+//the links are reversed on the way down and restored on the way back up, so no stack is needed
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::pull_spine(tree_node* top, const size_t count,
+                                         tree_node* tree_node::* link) {
+    if constexpr (augmented) {
+        tree_node* above = nullptr;
+        tree_node* current = top;
+        for (size_t i = 0; i < count; i++) {
+            tree_node* below = current->*link;
+            current->*link = above;
+            above = current;
+            current = below;
+        }
+
+        //current is now the subtree under the spine, and above its deepest node
+        while (above != nullptr) {
+            tree_node* next = above->*link;
+            above->*link = current;
+            pull(above);
+            current = above;
+            above = next;
+        }
+    }
+}
+
+//depths are counted with an explicit stack, so any tree depth is safe
+template <typename K, typename V, typename Augment, typename Compare>
+splay_stats splay_tree<K,V,Augment,Compare>::stats() const {
+    splay_stats stats;
+    stats.m_nodes = m_numElements;
+    std::vector<std::pair<const tree_node*, size_t>> stack;
+    if (m_root != nullptr) {
+        stack.emplace_back(m_root, 0);
+    }
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+        if (depth == stats.m_depths.size()) {
+            stats.m_depths.push_back(0);
+        }
+        stats.m_depths[depth]++;
+        if (node->m_left != nullptr) {
+            stack.emplace_back(node->m_left, depth + 1);
+        }
+        if (node->m_right != nullptr) {
+            stack.emplace_back(node->m_right, depth + 1);
+        }
+    }
+    stats.m_height = stats.m_depths.size();
+    stats.m_slabs = m_pool == nullptr ? 0 : m_pool->slab_count();
+#ifdef CS251_SPLAY_STATS
+    stats.m_counters = m_counters;
+#endif
+    return stats;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::reset_stats() {
+#ifdef CS251_SPLAY_STATS
+    m_counters = splay_counters();
+#endif
 }
 
-template <typename K, typename V>
-K splay_tree<K,V>::minimum_key() {
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw serialization_error("cannot open " + path + " for writing");
+    }
+    save(out);
+    out.close();
+    if (!out) {
+        throw serialization_error("cannot write " + path);
+    }
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::save(std::ostream& out) const {
+    out.write(file_magic, sizeof(file_magic));
+    serializer<uint32_t>::write(out, file_version);
+    write_nodes(out);
+    if (!out) {
+        throw serialization_error("cannot write the tree");
+    }
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw serialization_error("cannot open " + path + " for reading");
+    }
+    load(in);
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::load(std::istream& in) {
+    char magic[sizeof(file_magic)] = {};
+    in.read(magic, sizeof(magic));
+    uint32_t version = serializer<uint32_t>::read(in);
+    if (!in || !std::equal(magic, magic + sizeof(magic), file_magic) || version != file_version) {
+        throw serialization_error("not a saved splay_tree");
+    }
+
+    //a failed read leaves only the new tree half built
+    splay_tree loaded;
+    loaded.read_nodes(in);
+    loaded.m_policy = m_policy;
+    loaded.m_policyState = m_policyState;
+    if (m_stats != nullptr) {
+        loaded.m_stats = std::make_unique<access_stats>();
+        loaded.m_stats->m_interval = m_stats->m_interval;
+        loaded.m_stats->m_slack = m_stats->m_slack;
+    }
+#ifdef CS251_SPLAY_STATS
+    loaded.m_counters = m_counters;
+#endif
+    *this = std::move(loaded);
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::write_nodes(std::ostream& out) const {
+    serializer<uint64_t>::write(out, m_numElements);
+    std::vector<const tree_node*> stack;
+    if (m_root != nullptr) {
+        stack.push_back(m_root);
+    }
+    while (!stack.empty()) {
+        const tree_node* node = stack.back();
+        stack.pop_back();
+        uint8_t shape = (node->m_left != nullptr ? shape_left : 0) | (node->m_right != nullptr ? shape_right : 0) |
+                        (node->m_value != nullptr ? shape_value : 0);
+        serializer<uint8_t>::write(out, shape);
+        serializer<K>::write(out, node->m_key);
+        if (node->m_value != nullptr) {
+            serializer<V>::write(out, *node->m_value);
+        }
+
+        if (node->m_right != nullptr) {
+            stack.push_back(node->m_right);
+        }
+        if (node->m_left != nullptr) {
+            stack.push_back(node->m_left);
+        }
+    }
+}
+
+//rebuild the saved shape into this empty tree: each node fills the empty link it was saved from,
+//and its own links wait on a stack in preorder
+//on a throw, the nodes read so far form a tree of their own, which the caller discards
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::read_nodes(std::istream& in) {
+    uint64_t count = serializer<uint64_t>::read(in);
+    if (!in) {
+        throw serialization_error("saved tree is truncated");
+    }
+
+    std::vector<tree_node**> links {&m_root};
+    node_list preorder;
+    for (uint64_t i = 0; i < count; i++) {
+        uint8_t shape = serializer<uint8_t>::read(in);
+        K key = serializer<K>::read(in);
+        std::unique_ptr<V> value = shape & shape_value ? std::make_unique<V>(serializer<V>::read(in)) : nullptr;
+        if (!in) {
+            throw serialization_error("saved tree is truncated");
+        }
+        if (links.empty() || shape > (shape_left | shape_right | shape_value)) {
+            throw serialization_error("saved tree is corrupt");
+        }
+
+        tree_node* node = pool().allocate();
+        set_key(node, std::move(key));
+        node->m_value = std::move(value);
+        *links.back() = node;
+        links.pop_back();
+        m_numElements++;
+        preorder.push_back(node);
+        if (shape & shape_right) {
+            links.push_back(&node->m_right);
+        }
+        if (shape & shape_left) {
+            links.push_back(&node->m_left);
+        }
+    }
+    if (!links.empty() && count > 0) {
+        throw serialization_error("saved tree is corrupt");
+    }
+
+    //children come after their parents in preorder
+    for (size_t i = preorder.size(); i > 0; i--) {
+        pull(preorder[i - 1]);
+    }
+    m_min = leftmost(m_root);
+    m_max = rightmost(m_root);
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+K splay_tree<K,V,Augment,Compare>::minimum_key() {
 	if (m_numElements == 0) {
         throw empty_tree();
     }
 
-    std::shared_ptr<splay_tree_node> current = m_root;
+    tree_node* current = m_root;
+    size_t depth = 0;
     while (current->m_left != nullptr) {
         current = current->m_left;
+        depth++;
     }
 
-    splay(current);
+    splay(current->m_key, depth);
     return current->m_key;
 }
 
-template <typename K, typename V>
-K splay_tree<K,V>::maximum_key() {
+template <typename K, typename V, typename Augment, typename Compare>
+K splay_tree<K,V,Augment,Compare>::maximum_key() {
     if (m_numElements == 0) {
         throw empty_tree();
     }
 
-    std::shared_ptr<splay_tree_node> current = m_root;
+    tree_node* current = m_root;
+    size_t depth = 0;
     while (current->m_right != nullptr) {
         current = current->m_right;
+        depth++;
     }
 
-    splay(current);
+    splay(current->m_key, depth);
     return current->m_key;
 }
 
-template <typename K, typename V>
-bool splay_tree<K,V>::empty() const {
+template <typename K, typename V, typename Augment, typename Compare>
+const K& splay_tree<K,V,Augment,Compare>::first_key() {
+    if (m_min == nullptr) {
+        minimum_key();
+        m_min = m_root;
+    }
+    return m_min->m_key;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+const K& splay_tree<K,V,Augment,Compare>::last_key() {
+    if (m_max == nullptr) {
+        maximum_key();
+        m_max = m_root;
+    }
+    return m_max->m_key;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+std::pair<K, std::unique_ptr<V>> splay_tree<K,V,Augment,Compare>::extract_min() {
+    //the key outlives its node
+    K key = first_key();
+    std::unique_ptr<V> value = std::move(*try_extract(key));
+    return {std::move(key), std::move(value)};
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+std::pair<K, std::unique_ptr<V>> splay_tree<K,V,Augment,Compare>::extract_max() {
+    K key = last_key();
+    std::unique_ptr<V> value = std::move(*try_extract(key));
+    return {std::move(key), std::move(value)};
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+std::vector<std::pair<K, std::unique_ptr<V>>> splay_tree<K,V,Augment,Compare>::pop_k_smallest(const size_t k) {
+    std::vector<std::pair<K, std::unique_ptr<V>>> entries;
+    if (k == 0 || empty()) {
+        return entries;
+    }
+
+    //split at the first key to keep, so this tree holds exactly the entries to pop
+    splay_tree kept(m_pool);
+    if (k < m_numElements) {
+        const_iterator boundary = begin();
+        for (size_t i = 0; i < k; i++) {
+            ++boundary;
+        }
+        kept = split_off(boundary->m_key, true);
+    }
+
+    entries.reserve(m_numElements);
+    for (tree_node* node : detach_nodes()) {
+        entries.emplace_back(std::move(node->m_key), std::move(node->m_value));
+        m_pool->release(node);
+    }
+    append(kept);
+    return entries;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::tree_node* splay_tree<K,V,Augment,Compare>::leftmost(tree_node* node) {
+    while (node != nullptr && node->m_left != nullptr) {
+        node = node->m_left;
+    }
+    return node;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+typename splay_tree<K,V,Augment,Compare>::tree_node* splay_tree<K,V,Augment,Compare>::rightmost(tree_node* node) {
+    while (node != nullptr && node->m_right != nullptr) {
+        node = node->m_right;
+    }
+    return node;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+void splay_tree<K,V,Augment,Compare>::clear() {
+    if (m_pool.use_count() == 1) {
+        //nothing else allocates from the pool, so the nodes go back with their slabs
+        m_pool.reset();
+    } else {
+        //hand every node back to the shared pool, rotating left children up so the walk needs no stack
+        tree_node* current = m_root;
+        while (current != nullptr) {
+            if (current->m_left != nullptr) {
+                tree_node* left = current->m_left;
+                current->m_left = left->m_right;
+                left->m_right = current;
+                current = left;
+            } else {
+                tree_node* next = current->m_right;
+                m_pool->release(current);
+                current = next;
+            }
+        }
+    }
+    m_root = nullptr;
+    m_min = nullptr;
+    m_max = nullptr;
+    m_numElements = 0;
+}
+
+template <typename K, typename V, typename Augment, typename Compare>
+bool splay_tree<K,V,Augment,Compare>::empty() const {
 	return !m_root;
 }
 
-template <typename K, typename V>
-size_t splay_tree<K,V>::size() const {
+template <typename K, typename V, typename Augment, typename Compare>
+size_t splay_tree<K,V,Augment,Compare>::size() const {
 	return m_numElements;
 }
 
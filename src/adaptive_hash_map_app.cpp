@@ -2,6 +2,8 @@
 #include <sstream>
 #include <iomanip>
 #include <memory>
+#include <chrono>
+#include <thread>
 #include "app.hpp"
 #include "adaptive_hash_map.hpp"
 using namespace cs251;
@@ -14,8 +16,9 @@ using namespace cs251;
 template <typename K, typename V> void run_test();
 template <typename K, typename V> void print_table(const adaptive_hash_map<K,V>& hm);
 template <typename K, typename V>
-void print_tree(std::shared_ptr<typename splay_tree<K,V>::splay_tree_node> node,
+void print_tree(const typename splay_tree<K,V>::tree_node* node,
 		std::string prefix = "", std::string child_prefix = "");
+merge_policy read_policy(const std::string& policy);
 
 int main() {
 	try {
@@ -66,6 +69,8 @@ template <typename K, typename V> void run_test() {
 			return adaptive_hash_map<K,V>();
 		else
 			return adaptive_hash_map<K,V>(initial_capacity); })();
+	// Every bucket starts as a splay tree, so print shows the tree shapes until flat_buckets on
+	hm.set_flat_buckets(false);
 
 	// Read each command and execute until quit
 	while (true) {
@@ -78,23 +83,40 @@ template <typename K, typename V> void run_test() {
 				std::cin >> key >> *value;
 				std::cout << command << " " << key << " " << *value << std::endl;
 
-				hm.insert(key, std::move(value));
+				if (!hm.try_insert(key, std::move(value)))
+					std::cout << duplicate_key().what() << std::endl;
+
+			} else if (command == "insert_ttl") {
+				K key;
+				std::unique_ptr<V> value = std::make_unique<V>();
+				long long ttl;
+				std::cin >> key >> *value >> ttl;
+				std::cout << command << " " << key << " " << *value << " " << ttl << std::endl;
+
+				if (!hm.try_insert(key, std::move(value), std::chrono::milliseconds(ttl)))
+					std::cout << duplicate_key().what() << std::endl;
 
 			} else if (command == "peek") {
 				K key;
 				std::cin >> key;
 				std::cout << command << " " << key << std::endl;
 
-				const auto& value = hm.peek(key);
-				std::cout << *value << std::endl;
+				const auto* value = hm.find(key);
+				if (value)
+					std::cout << **value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
 
 			} else if (command == "extract") {
 				K key;
 				std::cin >> key;
 				std::cout << command << " " << key << std::endl;
 
-				auto value = hm.extract(key);
-				std::cout << *value << std::endl;
+				auto value = hm.try_extract(key);
+				if (value)
+					std::cout << **value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
 
 			} else if (command == "size") {
 				std::cout << command << std::endl;
@@ -127,6 +149,96 @@ template <typename K, typename V> void run_test() {
 				size_t buckets = hm.bucket_count();
 				std::cout << buckets << std::endl;
 
+			} else if (command == "resize") {
+				size_t capacity;
+				std::cin >> capacity;
+				std::cout << command << " " << capacity << std::endl;
+
+				hm.resize(capacity);
+
+			} else if (command == "flat_buckets") {
+				std::string setting;
+				std::cin >> setting;
+				std::cout << command << " " << setting << std::endl;
+
+				hm.set_flat_buckets(setting == "on");
+
+			} else if (command == "stats") {
+				std::cout << command << std::endl;
+
+				print_stats(std::cout, hm.stats());
+
+			} else if (command == "merge_into") {
+				// Merge this table into a new one holding the entries that follow, then print that table
+				size_t capacity, count;
+				std::string policy;
+				std::cin >> capacity >> policy >> count;
+				std::cout << command << " " << capacity << " " << policy << " " << count << std::endl;
+
+				adaptive_hash_map<K,V> other(capacity);
+				other.set_flat_buckets(false);
+				for (size_t i = 0; i < count; i++) {
+					K key;
+					std::unique_ptr<V> value = std::make_unique<V>();
+					std::cin >> key >> *value;
+					other.try_insert(key, std::move(value));
+				}
+				size_t moved = other.merge(hm, read_policy(policy));
+				std::cout << moved << std::endl;
+
+				print_table<K,V>(other);
+
+			} else if (command == "merge_ttl") {
+				// Merge this table into a new one holding the entries that follow, each with a
+				// time-to-live in milliseconds (0 for none), and carry on with the merged table
+				size_t capacity, count;
+				std::string policy;
+				std::cin >> capacity >> policy >> count;
+				std::cout << command << " " << capacity << " " << policy << " " << count << std::endl;
+
+				adaptive_hash_map<K,V> other(capacity);
+				other.set_flat_buckets(hm.flat_buckets());
+				for (size_t i = 0; i < count; i++) {
+					K key;
+					std::unique_ptr<V> value = std::make_unique<V>();
+					long long ttl;
+					std::cin >> key >> *value >> ttl;
+					if (ttl == 0)
+						other.try_insert(key, std::move(value));
+					else
+						other.try_insert(key, std::move(value), std::chrono::milliseconds(ttl));
+				}
+				size_t moved = other.merge(hm, read_policy(policy));
+				std::cout << moved << std::endl;
+
+				hm = std::move(other);
+
+			} else if (command == "purge_expired") {
+				std::cout << command << std::endl;
+
+				std::cout << hm.purge_expired() << std::endl;
+
+			} else if (command == "sleep") {
+				long long ms;
+				std::cin >> ms;
+				std::cout << command << " " << ms << std::endl;
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+
+			} else if (command == "save") {
+				std::string path;
+				std::cin >> path;
+				std::cout << command << " " << path << std::endl;
+
+				hm.save(path);
+
+			} else if (command == "load") {
+				std::string path;
+				std::cin >> path;
+				std::cout << command << " " << path << std::endl;
+
+				hm.load(path);
+
 			} else if (command == "quit") {
 				std::cout << command << std::endl;
 
@@ -147,18 +259,30 @@ template <typename K, typename V> void print_table(const adaptive_hash_map<K,V>&
 		std::string prefix = ss.str();
 		std::string child_prefix = "     ";
 
+		if (data.is_flat(i)) {
+			// A flat bucket lists its entries in the order it holds them
+			std::cout << prefix << "[flat]";
+			std::string separator = " ";
+			data.for_each_flat(i, [&](const K& key, const std::unique_ptr<V>& value) {
+				std::cout << separator << key << " -> " << *value;
+				separator = ", ";
+			});
+			std::cout << std::endl;
+			continue;
+		}
+
 		const auto& tree = data[i];
 		if (tree.empty()) {
 			std::cout << prefix << "[empty]" << std::endl;
 			continue;
 		}
 
-		print_tree<K,V>(tree.get_root(), prefix, child_prefix);
+		print_tree<K,V>(tree.root(), prefix, child_prefix);
 	}
 }
 
 template <typename K, typename V>
-void print_tree(std::shared_ptr<typename splay_tree<K,V>::splay_tree_node> node,
+void print_tree(const typename splay_tree<K,V>::tree_node* node,
 		std::string prefix, std::string child_prefix) {
 	if (!node) return;
 
@@ -172,3 +296,13 @@ void print_tree(std::shared_ptr<typename splay_tree<K,V>::splay_tree_node> node,
 		print_tree<K,V>(node->m_right, child_prefix + "└R: ", child_prefix + " ");
 	}
 }
+
+merge_policy read_policy(const std::string& policy) {
+	if (policy == "keep_existing")
+		return merge_policy::keep_existing;
+	if (policy == "overwrite")
+		return merge_policy::overwrite;
+	if (policy == "collect")
+		return merge_policy::collect;
+	throw std::invalid_argument("Unknown merge policy!");
+}
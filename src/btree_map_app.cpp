@@ -0,0 +1,164 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include "app.hpp"
+#include "btree_map.hpp"
+using namespace cs251;
+
+/*
+* Driver for btree_map that reads the splay_tree_app test format; every command but print
+* produces the same output as splay_tree_app.
+*/
+template <typename K, typename V> void run_test();
+template <typename K, typename V>
+void print_tree(const typename btree_map<K,V>::btree_node* node,
+		std::string prefix = "", std::string child_prefix = "");
+
+int main() {
+	try {
+		std::string key_type, value_type;
+		std::cin >> key_type >> value_type;
+		if (key_type == "int") {
+			if (value_type == "int")
+				run_test<int,int>();
+			else if (value_type == "float")
+				run_test<int,float>();
+			else if (value_type == "string")
+				run_test<int,std::string>();
+			else if (value_type == "name")
+				run_test<int,name>();
+		} else if (key_type == "string") {
+			if (value_type == "int")
+				run_test<std::string,int>();
+			else if (value_type == "float")
+				run_test<std::string,float>();
+			else if (value_type == "string")
+				run_test<std::string,std::string>();
+			else if (value_type == "name")
+				run_test<std::string,name>();
+		} else if (key_type == "name") {
+			if (value_type == "int")
+				run_test<name,int>();
+			else if (value_type == "float")
+				run_test<name,float>();
+			else if (value_type == "string")
+				run_test<name,std::string>();
+			else if (value_type == "name")
+				run_test<name,name>();
+		}
+	} catch (const std::exception& e) {
+		std::cerr << "Unhandled exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+template <typename K, typename V> void run_test() {
+	// Create the B-tree
+	btree_map<K,V> tree;
+
+	while (true) {
+		std::string command;
+		std::cin >> command;
+		try {
+			if (command == "insert") {
+				K key;
+				std::unique_ptr<V> value = std::make_unique<V>();
+				std::cin >> key >> *value;
+				std::cout << command << " " << key << " " << *value << std::endl;
+
+				if (!tree.try_insert(key, std::move(value)))
+					std::cout << duplicate_key().what() << std::endl;
+
+			} else if (command == "peek") {
+				K key;
+				std::cin >> key;
+				std::cout << command << " " << key << std::endl;
+
+				const auto* value = tree.find(key);
+				if (value)
+					std::cout << **value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
+
+			} else if (command == "extract") {
+				K key;
+				std::cin >> key;
+				std::cout << command << " " << key << std::endl;
+
+				auto value = tree.try_extract(key);
+				if (value)
+					std::cout << **value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
+
+			} else if (command == "size") {
+				std::cout << command << std::endl;
+
+				size_t size = tree.size();
+				std::cout << size << std::endl;
+
+			} else if (command == "empty") {
+				std::cout << command << std::endl;
+
+				bool empty = tree.empty();
+				std::cout << (empty ? "true" : "false") << std::endl;
+
+			} else if (command == "print") {
+				std::cout << command << std::endl;
+
+				if (tree.empty())
+					std::cout << "[empty]" << std::endl;
+				else
+					print_tree<K,V>(tree.get_root());
+
+			} else if (command == "minimum_key") {
+				std::cout << command << std::endl;
+
+				K min_key = tree.minimum_key();
+				std::cout << min_key << std::endl;
+
+			} else if (command == "maximum_key") {
+				std::cout << command << std::endl;
+
+				K max_key = tree.maximum_key();
+				std::cout << max_key << std::endl;
+
+			} else if (command == "quit") {
+				std::cout << command << std::endl;
+
+				break;
+			}
+		} catch (const std::exception& e) {
+			std::cout << e.what() << std::endl;
+		}
+	}
+}
+
+// Inner nodes print their separator keys, leaves their key -> value pairs
+template <typename K, typename V>
+void print_tree(const typename btree_map<K,V>::btree_node* node,
+		std::string prefix, std::string child_prefix) {
+	if (!node) return;
+
+	std::cout << prefix;
+	if (node->m_leaf) {
+		const auto* leaf = static_cast<const typename btree_map<K,V>::btree_leaf*>(node);
+		for (size_t i = 0; i < leaf->m_count; i++)
+			std::cout << (i ? ", " : "") << leaf->m_keys[i] << " -> " << *leaf->m_values[i];
+		std::cout << std::endl;
+		return;
+	}
+
+	const auto* inner = static_cast<const typename btree_map<K,V>::btree_inner*>(node);
+	std::cout << "[";
+	for (size_t i = 0; i < inner->m_count; i++)
+		std::cout << (i ? " | " : "") << inner->m_keys[i];
+	std::cout << "]" << std::endl;
+	for (size_t i = 0; i <= inner->m_count; i++) {
+		bool last = i == inner->m_count;
+		print_tree<K,V>(inner->m_children[i], child_prefix + (last ? "└─ " : "├─ "),
+				child_prefix + (last ? "   " : "│  "));
+	}
+}
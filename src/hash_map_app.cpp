@@ -2,6 +2,9 @@
 #include <sstream>
 #include <iomanip>
 #include <memory>
+#include <chrono>
+#include <thread>
+#include <optional>
 #include "app.hpp"
 #include "hash_map.hpp"
 using namespace cs251;
@@ -13,6 +16,7 @@ using namespace cs251;
 */
 template <typename K, typename V> void run_test();
 template <typename K, typename V> void print_table(const hash_map<K,V>& hm);
+merge_policy read_policy(const std::string& policy);
 
 int main() {
 	try {
@@ -63,6 +67,8 @@ template <typename K, typename V> void run_test() {
 			return hash_map<K,V>();
 		else
 			return hash_map<K,V>(initial_capacity); })();
+	// The most recent snapshot of the table, if one was taken
+	std::optional<typename hash_map<K,V>::snapshot_view> snapshot;
 
 	// Read each command and execute until quit
 	while (true) {
@@ -75,23 +81,53 @@ template <typename K, typename V> void run_test() {
 				std::cin >> key >> *value;
 				std::cout << command << " " << key << " " << *value << std::endl;
 
-				hm.insert(key, std::move(value));
+				if (!hm.try_insert(key, std::move(value)))
+					std::cout << duplicate_key().what() << std::endl;
+
+			} else if (command == "insert_ttl") {
+				K key;
+				std::unique_ptr<V> value = std::make_unique<V>();
+				long long ttl;
+				std::cin >> key >> *value >> ttl;
+				std::cout << command << " " << key << " " << *value << " " << ttl << std::endl;
+
+				if (!hm.try_insert(key, std::move(value), std::chrono::milliseconds(ttl)))
+					std::cout << duplicate_key().what() << std::endl;
 
 			} else if (command == "peek") {
 				K key;
 				std::cin >> key;
 				std::cout << command << " " << key << std::endl;
 
-				const auto& value = hm.peek(key);
-				std::cout << *value << std::endl;
+				const auto* value = hm.find(key);
+				if (value)
+					std::cout << **value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
+
+			} else if (command == "update") {
+				// Change a value in place through the pointer find returns
+				K key;
+				V value;
+				std::cin >> key >> value;
+				std::cout << command << " " << key << " " << value << std::endl;
+
+				const auto* current = hm.find(key);
+				if (current)
+					**current = value;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
 
 			} else if (command == "extract") {
 				K key;
 				std::cin >> key;
 				std::cout << command << " " << key << std::endl;
 
-				auto value = hm.extract(key);
-				std::cout << *value << std::endl;
+				auto value = hm.try_extract(key);
+				if (value)
+					std::cout << **value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
 
 			} else if (command == "size") {
 				std::cout << command << std::endl;
@@ -131,6 +167,58 @@ template <typename K, typename V> void run_test() {
 
 				hm.resize(capacity);
 
+			} else if (command == "merge_into") {
+				// Merge this table into a new one holding the entries that follow, then print that table
+				size_t capacity, count;
+				std::string policy;
+				std::cin >> capacity >> policy >> count;
+				std::cout << command << " " << capacity << " " << policy << " " << count << std::endl;
+
+				hash_map<K,V> other(capacity);
+				for (size_t i = 0; i < count; i++) {
+					K key;
+					std::unique_ptr<V> value = std::make_unique<V>();
+					std::cin >> key >> *value;
+					other.try_insert(key, std::move(value));
+				}
+				size_t moved = other.merge(hm, read_policy(policy));
+				std::cout << moved << std::endl;
+
+				print_table<K,V>(other);
+
+			} else if (command == "snapshot") {
+				std::cout << command << std::endl;
+
+				snapshot.emplace(hm.snapshot());
+
+			} else if (command == "snapshot_peek") {
+				K key;
+				std::cin >> key;
+				std::cout << command << " " << key << std::endl;
+
+				const auto* value = snapshot ? snapshot->find(key) : nullptr;
+				if (value)
+					std::cout << **value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
+
+			} else if (command == "snapshot_print") {
+				std::cout << command << std::endl;
+
+				if (snapshot) {
+					std::cout << snapshot->size() << " of " << snapshot->bucket_count() << std::endl;
+					snapshot->for_each([](const K& key, const std::unique_ptr<V>& value) {
+						std::cout << key << " -> " << *value << std::endl;
+					});
+				}
+
+			} else if (command == "sleep") {
+				long long ms;
+				std::cin >> ms;
+				std::cout << command << " " << ms << std::endl;
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+
 			} else if (command == "quit") {
 				std::cout << command << std::endl;
 
@@ -166,3 +254,13 @@ template <typename K, typename V> void print_table(const hash_map<K,V>& hm) {
 		std::cout << std::endl;
 	}
 }
+
+merge_policy read_policy(const std::string& policy) {
+	if (policy == "keep_existing")
+		return merge_policy::keep_existing;
+	if (policy == "overwrite")
+		return merge_policy::overwrite;
+	if (policy == "collect")
+		return merge_policy::collect;
+	throw std::invalid_argument("Unknown merge policy!");
+}
@@ -0,0 +1,179 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <memory>
+#include <type_traits>
+#include "app.hpp"
+#include "lru_cache.hpp"
+using namespace cs251;
+
+/*
+* Driver for lru_cache, reading the hash_map_app test format with the entry and byte budgets
+* in place of the initial capacity.
+*/
+template <typename K, typename V> void run_test();
+template <typename K, typename V> void print_cache(const lru_cache<K,V>& cache);
+
+int main() {
+	try {
+		std::string key_type, value_type;
+		std::cin >> key_type >> value_type;
+		if (key_type == "int") {
+			if (value_type == "int")
+				run_test<int,int>();
+			else if (value_type == "float")
+				run_test<int,float>();
+			else if (value_type == "string")
+				run_test<int,std::string>();
+			else if (value_type == "name")
+				run_test<int,name>();
+		} else if (key_type == "string") {
+			if (value_type == "int")
+				run_test<std::string,int>();
+			else if (value_type == "float")
+				run_test<std::string,float>();
+			else if (value_type == "string")
+				run_test<std::string,std::string>();
+			else if (value_type == "name")
+				run_test<std::string,name>();
+		} else if (key_type == "name") {
+			if (value_type == "int")
+				run_test<name,int>();
+			else if (value_type == "float")
+				run_test<name,float>();
+			else if (value_type == "string")
+				run_test<name,std::string>();
+			else if (value_type == "name")
+				run_test<name,name>();
+		}
+	} catch (const std::exception& e) {
+		std::cerr << "Unhandled exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+template <typename K, typename V> void run_test() {
+	// Read the entry budget and the byte budget (0 for none)
+	size_t max_entries, max_bytes;
+	std::cin >> max_entries >> max_bytes;
+
+	lru_cache<K,V> cache(max_entries, max_bytes);
+
+	// Read each command and execute until quit
+	while (true) {
+		std::string command;
+		std::cin >> command;
+		try {
+			if (command == "insert") {
+				K key;
+				std::unique_ptr<V> value = std::make_unique<V>();
+				std::cin >> key >> *value;
+				std::cout << command << " " << key << " " << *value << std::endl;
+
+				if (!cache.try_insert(key, std::move(value)))
+					std::cout << duplicate_key().what() << std::endl;
+
+			} else if (command == "peek") {
+				K key;
+				std::cin >> key;
+				std::cout << command << " " << key << std::endl;
+
+				const auto* value = cache.find(key);
+				if (value)
+					std::cout << **value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
+
+			} else if (command == "append") {
+				// Grow a string value in place through find, which the byte budget does not see
+				K key;
+				size_t count;
+				std::cin >> key >> count;
+				std::cout << command << " " << key << " " << count << std::endl;
+
+				const auto* value = cache.find(key);
+				if constexpr (std::is_same_v<V, std::string>) {
+					if (value)
+						(*value)->append(count, 'x');
+					else
+						std::cout << nonexistent_key().what() << std::endl;
+				} else {
+					throw std::invalid_argument("Only string values can be appended to!");
+				}
+
+			} else if (command == "extract") {
+				K key;
+				std::cin >> key;
+				std::cout << command << " " << key << std::endl;
+
+				auto value = cache.try_extract(key);
+				if (value)
+					std::cout << **value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
+
+			} else if (command == "lru_key") {
+				std::cout << command << std::endl;
+
+				std::cout << cache.lru_key() << std::endl;
+
+			} else if (command == "size") {
+				std::cout << command << std::endl;
+
+				size_t size = cache.size();
+				std::cout << size << std::endl;
+
+			} else if (command == "empty") {
+				std::cout << command << std::endl;
+
+				bool empty = cache.empty();
+				std::cout << (empty ? "true" : "false") << std::endl;
+
+			} else if (command == "bytes") {
+				std::cout << command << std::endl;
+
+				std::cout << cache.bytes() << std::endl;
+
+			} else if (command == "stats") {
+				std::cout << command << std::endl;
+
+				std::cout << "hits " << cache.hits() << std::endl;
+				std::cout << "misses " << cache.misses() << std::endl;
+				std::cout << "evictions " << cache.evictions() << std::endl;
+
+			} else if (command == "print") {
+				std::cout << command << std::endl;
+
+				print_cache<K,V>(cache);
+
+			} else if (command == "quit") {
+				std::cout << command << std::endl;
+
+				break;
+			}
+		} catch (const std::exception& e) {
+			std::cout << e.what() << std::endl;
+		}
+	}
+}
+
+// Print the entries from the most to the least recently used
+template <typename K, typename V> void print_cache(const lru_cache<K,V>& cache) {
+	if (cache.empty()) {
+		std::cout << "[empty]" << std::endl;
+		return;
+	}
+
+	size_t position = 0;
+	cache.for_each([&](const K& key, const std::unique_ptr<V>& value) {
+		if (!value) {
+			std::stringstream ss;
+			ss << "Error in cache position " << position << ", key "
+				<< key << ": value is null!";
+			throw std::runtime_error(ss.str());
+		}
+
+		std::cout << std::setw(3) << position++ << ": " << key << " -> " << *value << std::endl;
+	});
+}
@@ -2,6 +2,7 @@
 #include <sstream>
 #include <iomanip>
 #include <memory>
+#include <vector>
 #include "app.hpp"
 #include "splay_tree.hpp"
 using namespace cs251;
@@ -11,9 +12,12 @@ using namespace cs251;
 * You can modify the code based on your needs, but the original copy of this
 * file will be used for testing.
 */
+// The tree counts the nodes of each subtree, which rank and select need
+template <typename K, typename V> using app_tree = splay_tree<K,V,subtree_size>;
+
 template <typename K, typename V> void run_test();
 template <typename K, typename V>
-void print_tree(std::shared_ptr<typename splay_tree<K,V>::splay_tree_node> node,
+void print_tree(const typename app_tree<K,V>::tree_node* node,
 		std::string prefix = "", std::string child_prefix = "");
 
 int main() {
@@ -57,7 +61,7 @@ int main() {
 
 template <typename K, typename V> void run_test() {
 	// Create the splay tree
-	splay_tree<K,V> tree;
+	app_tree<K,V> tree;
 
 	while (true) {
 		std::string command;
@@ -69,23 +73,47 @@ template <typename K, typename V> void run_test() {
 				std::cin >> key >> *value;
 				std::cout << command << " " << key << " " << *value << std::endl;
 
-				tree.insert(key, std::move(value));
+				if (!tree.try_insert(key, std::move(value)))
+					std::cout << duplicate_key().what() << std::endl;
 
 			} else if (command == "peek") {
 				K key;
 				std::cin >> key;
 				std::cout << command << " " << key << std::endl;
 
-				const auto& value = tree.peek(key);
-				std::cout << *value << std::endl;
+				const auto* value = tree.find(key);
+				if (value)
+					std::cout << **value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
+
+			} else if (command == "peek_many") {
+				// Look up the keys that follow as one batch, which does not splay
+				size_t count;
+				std::cin >> count;
+				std::vector<K> keys(count);
+				for (K& key : keys)
+					std::cin >> key;
+				std::cout << command << " " << count << std::endl;
+
+				const auto values = tree.peek_many(keys);
+				for (size_t i = 0; i < count; i++) {
+					if (values[i])
+						std::cout << keys[i] << " -> " << **values[i] << std::endl;
+					else
+						std::cout << keys[i] << ": " << nonexistent_key().what() << std::endl;
+				}
 
 			} else if (command == "extract") {
 				K key;
 				std::cin >> key;
 				std::cout << command << " " << key << std::endl;
 
-				auto value = tree.extract(key);
-				std::cout << *value << std::endl;
+				auto value = tree.try_extract(key);
+				if (value)
+					std::cout << **value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
 
 			} else if (command == "size") {
 				std::cout << command << std::endl;
@@ -105,7 +133,7 @@ template <typename K, typename V> void run_test() {
 				if (tree.empty())
 					std::cout << "[empty]" << std::endl;
 				else
-					print_tree<K,V>(tree.get_root());
+					print_tree<K,V>(tree.root());
 
 			} else if (command == "minimum_key") {
 				std::cout << command << std::endl;
@@ -119,6 +147,182 @@ template <typename K, typename V> void run_test() {
 				K max_key = tree.maximum_key();
 				std::cout << max_key << std::endl;
 
+			} else if (command == "first_key") {
+				std::cout << command << std::endl;
+
+				std::cout << tree.first_key() << std::endl;
+
+			} else if (command == "last_key") {
+				std::cout << command << std::endl;
+
+				std::cout << tree.last_key() << std::endl;
+
+			} else if (command == "extract_min" || command == "extract_max") {
+				std::cout << command << std::endl;
+
+				auto entry = command == "extract_min" ? tree.extract_min() : tree.extract_max();
+				std::cout << entry.first << " -> " << *entry.second << std::endl;
+
+			} else if (command == "pop_k_smallest") {
+				size_t k;
+				std::cin >> k;
+				std::cout << command << " " << k << std::endl;
+
+				for (const auto& entry : tree.pop_k_smallest(k))
+					std::cout << entry.first << " -> " << *entry.second << std::endl;
+
+			} else if (command == "extract_range") {
+				K lo, hi;
+				std::cin >> lo >> hi;
+				std::cout << command << " " << lo << " " << hi << std::endl;
+
+				for (const auto& node : tree.extract_range(lo, hi))
+					std::cout << node.m_key << " -> " << *node.m_value << std::endl;
+
+			} else if (command == "range") {
+				// List the entries with lo <= key <= hi, which splays only the first of them
+				K lo, hi;
+				std::cin >> lo >> hi;
+				std::cout << command << " " << lo << " " << hi << std::endl;
+
+				tree.for_each_in_range(lo, hi, [](const K& key, const std::unique_ptr<V>& value) {
+					std::cout << key << " -> " << *value << std::endl;
+				});
+
+			} else if (command == "lower_bound" || command == "upper_bound") {
+				K key;
+				std::cin >> key;
+				std::cout << command << " " << key << std::endl;
+
+				auto it = command == "lower_bound" ? tree.lower_bound(key) : tree.upper_bound(key);
+				if (it != tree.end())
+					std::cout << it->m_key << " -> " << *it->m_value << std::endl;
+				else
+					std::cout << nonexistent_key().what() << std::endl;
+
+			} else if (command == "build_sorted" || command == "build") {
+				// Replace the tree with one bulk loaded from the entries that follow
+				size_t count;
+				std::cin >> count;
+				std::cout << command << " " << count << std::endl;
+
+				std::vector<std::pair<K, std::unique_ptr<V>>> entries;
+				for (size_t i = 0; i < count; i++) {
+					K key;
+					std::unique_ptr<V> value = std::make_unique<V>();
+					std::cin >> key >> *value;
+					entries.emplace_back(key, std::move(value));
+				}
+				if (command == "build_sorted")
+					tree = app_tree<K,V>::build_sorted(entries);
+				else
+					tree = app_tree<K,V>::build(entries, true);
+
+			} else if (command == "prefix") {
+				std::string prefix;
+				std::cin >> prefix;
+				std::cout << command << " " << prefix << std::endl;
+
+				if constexpr (prefix_scan<K>::enabled) {
+					tree.for_each_with_prefix(prefix, [](const K& key, const std::unique_ptr<V>& value) {
+						std::cout << key << " -> " << *value << std::endl;
+					});
+				} else {
+					throw std::invalid_argument("Prefix scans need string or name keys!");
+				}
+
+			} else if (command == "rank") {
+				K key;
+				std::cin >> key;
+				std::cout << command << " " << key << std::endl;
+
+				std::cout << tree.rank(key) << std::endl;
+
+			} else if (command == "select") {
+				size_t i;
+				std::cin >> i;
+				std::cout << command << " " << i << std::endl;
+
+				auto it = tree.select(i);
+				if (it == tree.end())
+					throw std::out_of_range("Index out of range!");
+				std::cout << it->m_key << " -> " << *it->m_value << std::endl;
+
+			} else if (command == "splay_policy") {
+				// Set how peek restructures the tree: full, semi, every_kth period,
+				// probability p or depth_threshold factor
+				std::string mode;
+				std::cin >> mode;
+				std::cout << command << " " << mode;
+
+				splay_policy policy;
+				if (mode == "full") {
+					policy = splay_policy::full();
+				} else if (mode == "semi") {
+					policy = splay_policy::semi();
+				} else if (mode == "every_kth") {
+					uint32_t period;
+					std::cin >> period;
+					std::cout << " " << period;
+					policy = splay_policy::every_kth(period);
+				} else if (mode == "probability") {
+					float probability;
+					std::cin >> probability;
+					std::cout << " " << probability;
+					policy = splay_policy::with_probability(probability);
+				} else if (mode == "depth_threshold") {
+					float factor;
+					std::cin >> factor;
+					std::cout << " " << factor;
+					policy = splay_policy::depth_threshold(factor);
+				} else {
+					std::cout << std::endl;
+					throw std::invalid_argument("Unknown splay policy!");
+				}
+				std::cout << std::endl;
+
+				tree.set_splay_policy(policy);
+
+			} else if (command == "access_tracking") {
+				std::string setting;
+				std::cin >> setting;
+				std::cout << command << " " << setting << std::endl;
+
+				tree.set_access_tracking(setting == "on");
+
+			} else if (command == "rebuild_weighted") {
+				std::cout << command << std::endl;
+
+				tree.rebuild_weighted();
+
+			} else if (command == "auto_rebuild") {
+				// Check the hit depths every interval hits and rebuild past slack times the bound
+				size_t interval;
+				double slack;
+				std::cin >> interval >> slack;
+				std::cout << command << " " << interval << " " << slack << std::endl;
+
+				tree.set_auto_rebuild(interval, slack);
+
+			} else if (command == "stats") {
+				std::cout << command << std::endl;
+
+				print_stats(std::cout, tree.stats());
+
+			} else if (command == "save") {
+				std::string path;
+				std::cin >> path;
+				std::cout << command << " " << path << std::endl;
+
+				tree.save(path);
+
+			} else if (command == "load") {
+				std::string path;
+				std::cin >> path;
+				std::cout << command << " " << path << std::endl;
+
+				tree.load(path);
+
 			} else if (command == "quit") {
 				std::cout << command << std::endl;
 
@@ -131,7 +335,7 @@ template <typename K, typename V> void run_test() {
 }
 
 template <typename K, typename V>
-void print_tree(std::shared_ptr<typename splay_tree<K,V>::splay_tree_node> node,
+void print_tree(const typename app_tree<K,V>::tree_node* node,
 		std::string prefix, std::string child_prefix) {
 	if (!node) return;
 